@@ -190,6 +190,42 @@
 //#define REMOTE_SIGNAL_PIN 7
 
 
+/***** Block transfer of data in controller mode *****/
+/*
+ * Uses a tight handshake loop for the data bytes sent or received in
+ * controller mode, sampling the timeout timer only when the bus stalls.
+ * Comment out to use the per-byte handshake state machine instead.
+ * No throughput figures have been measured for either path yet: build with
+ * DEBUG_GPIBbus_THROUGHPUT, with and without this, to compare them.
+ */
+#define GPIB_BLOCK_TRANSFER
+
+
+/***** Interrupt driven receive in continuous auto mode *****/
+/*
+ * In continuous auto mode (++auto 3), the handshake of the received bytes
+ * is done by the DAV pin change interrupt, which fills a FIFO that the main
+ * loop empties. The network is then still served while a slow instrument
+ * is sending. Comment out to use the blocking receiveData() instead.
+ */
+#define GPIB_INTERRUPT_RECEIVE
+#define GPIB_RX_FIFO_SIZE 64
+
+
+/***** Listener detection (++fndl) *****/
+/*
+ * Time in microseconds the devices that are not addressed are given to
+ * release NDAC after ATN is released. IEEE-488.1 requires the acceptor
+ * handshake to follow ATN within 200 ns, and a 20 m cable adds about
+ * 100 ns. 100 us is 500 times that: it also covers devices that handle
+ * ATN in firmware, with an interrupt latency of some tens of microseconds.
+ * findListener() checks NDAC again after a second window, so a device
+ * that releases NDAC only after the first window, but within the second,
+ * gives no false positive either.
+ */
+#define GPIB_LISTENER_SETTLE_US 100
+
+
 /***** 8-way address DIP switch *****/
 #define DIP_SWITCH
 #ifdef DIP_SWITCH
@@ -228,6 +264,7 @@
   //#define DEBUG_GPIBbus_RECEIVE // GPIBbus::receiveData(), GPIBbus::readByte()
   //#define DEBUG_GPIBbus_SEND    // GPIBbus::sendData()
   //#define DEBUG_GPIBbus_CONTROL // GPIBbus::setControls() 
+  //#define DEBUG_GPIBbus_THROUGHPUT // GPIBbus::receiveData(), GPIBbus::sendData() bytes/s, to compare with and without GPIB_BLOCK_TRANSFER
   //#define DEBUG_GPIB_COMMANDS   // GPIBbus::sendCDC(), GPIBbus::sendLLO(), GPIBbus::sendLOC(), GPIBbus::sendGTL(), GPIBbus::sendMSA() 
   //#define DEBUG_GPIB_ADDRESSING // GPIBbus::sendMA(), GPIBbus::sendMLA(), GPIBbus::sendUNT(), GPIBbus::sendUNL() 
   //#define DEBUG_GPIB_DEVICE     // GPIBbus::unAddressDevice(), GPIBbus::addressDevice
@@ -33,7 +33,15 @@ GPIBbus::GPIBbus() {
   // Default configuration values
   setDefaultCfg();
   cstate = 0;
-  deviceAddressed = TONONE;
+  clearAddressCache();
+  idleCallback = NULL;
+  idleMillis = 0;
+  ioTimeout = 0;
+  ioTimed = false;
+  knownDevices = 0;
+#ifdef GPIB_INTERRUPT_RECEIVE
+  bgReceiving = false;
+#endif
 }
 
 
@@ -58,6 +66,9 @@ void GPIBbus::begin() {
 /***** Stops active mode and bring control and data bus to inactive state *****/
 void GPIBbus::stop() {
   cstate = 0;
+#ifdef GPIB_INTERRUPT_RECEIVE
+  stopBackgroundReceive();
+#endif
   // Set control bus to idle state (all lines input_pullup)
 //Serial.println(F("Clear all signals to input pullup"));
   clearAllSignals();
@@ -171,6 +182,8 @@ void GPIBbus::setTransmitMode(enum transmitModes mode) {
 }
 
 
+// The custom layout has inline versions in AR488_GPIBbus.h
+#ifndef AR488_CUSTOM
 /***** Assert an individual or group of signals *****/
 void GPIBbus::assertSignal(uint8_t sig) {
   // Note: GPIO pin direction assumed set by setOperatingMode()
@@ -183,6 +196,7 @@ void GPIBbus::clearSignal(uint8_t sig) {
   // Note: GPIO pin direction assumed set by setOperatingMode()
   setGpibCtrlState(sig, sig);   // Set all signals permitted by mask to HIGH (unasserted)
 }
+#endif
 
 
 /***** Clear all GPIB control signals *****/
@@ -199,6 +213,8 @@ bool GPIBbus::isController() {
 
 
 /***** Detect selected pin state *****/
+// The custom layout has an inline version in AR488_GPIBbus.h
+#ifndef AR488_CUSTOM
 bool GPIBbus::isAsserted(uint8_t gpibsig) {
 #ifdef AR488_MCP23S17 
   uint8_t mcpPinAssertedReg = 0;
@@ -211,6 +227,7 @@ bool GPIBbus::isAsserted(uint8_t gpibsig) {
   if (getGpibPinState(gpibsig) == LOW) return true;
   return false;
 }
+#endif
 
 
 /***** Send the device status byte *****/
@@ -246,6 +263,8 @@ void GPIBbus::sendIFC() {
   delayMicroseconds(150);
   // De-assert IFC
   clearSignal(IFC_BIT);
+  // IFC unaddresses all devices
+  clearAddressCache();
 }
 
 
@@ -377,6 +396,126 @@ bool GPIBbus::sendGET(uint8_t addr) {
 }
 
 
+/***** Serial poll a single device *****/
+/*
+ * UNL, SPE, TAD (+ SAD), read the status byte, SPD, UNT, UNL.
+ * Leaves no device addressed.
+ */
+bool GPIBbus::serialPoll(uint8_t pri, uint8_t sec, uint8_t *stb) {
+  enum gpibHandshakeStates state;
+
+#ifdef DEBUG_GPIB_COMMANDS
+  DB_PRINT(F("serial poll of "), pri);
+#endif
+  if ((pri > 30) || (sec < 0x60 && sec != 0xFF) || (sec > 0x7E && sec != 0xFF)) return ERR;
+
+  if (beginSerialPoll()) return ERR;
+  state = pollStatus(pri, sec, stb);
+  // Disable serial poll and unaddress, also after a failed read
+  if (endSerialPoll()) return ERR;
+
+  if (state != HANDSHAKE_COMPLETE) {
+#ifdef DEBUG_GPIB_COMMANDS
+    DB_PRINT(F("failed to read the status byte"), "");
+#endif
+    return ERR;
+  }
+#ifdef DEBUG_GPIB_COMMANDS
+  DB_PRINT(F("done, status byte="), *stb);
+#endif
+  return OK;
+}
+
+
+/***** Serial poll a set of devices in one sequence *****/
+/*
+ * devices is a bitmap of primary addresses (bit n = address n). Sends UNL
+ * and SPE once, then TAD and a status byte read per device, and SPD,
+ * UNT and UNL once at the end. stb must hold 31 bytes: stb[n] receives the
+ * status byte of address n. *rqs receives the bitmap of the devices that
+ * requested service (RQS, bit 6). With stopOnRqs, the poll ends at the
+ * first of them, so that the others keep their request.
+ * Use getKnownDevices() to poll only the devices that are on the bus.
+ */
+bool GPIBbus::pollDevices(uint32_t devices, uint8_t *stb, uint32_t *rqs, bool stopOnRqs) {
+  *rqs = 0;
+
+  if (beginSerialPoll()) return ERR;
+  for (uint8_t pri = 0; pri <= 30; pri++) {
+    if (!(devices & (1UL << pri))) continue;
+    stb[pri] = 0;
+    if (pollStatus(pri, 0xFF, &stb[pri]) != HANDSHAKE_COMPLETE) continue;
+    if (stb[pri] & 0x40) {
+      *rqs |= (1UL << pri);
+      if (stopOnRqs) break;
+    }
+  }
+  return endSerialPoll();
+}
+
+
+/***** Devices known to be on the bus *****/
+/*
+ * Bitmap of primary addresses (bit n = address n), kept up to date by
+ * findListener() and the serial polls.
+ */
+uint32_t GPIBbus::getKnownDevices() {
+  return knownDevices;
+}
+
+
+/***** Check whether a device listens at an address *****/
+/*
+ * Addresses the device as listener (UNL, UNT, LAD, and the secondary addresses
+ * firstSec..lastSec unless firstSec is 0xFF), releases ATN and samples NDAC:
+ * devices that are not addressed release NDAC within the ATN response time,
+ * an addressed listener keeps it asserted, as no data follows. NDAC is
+ * sampled at the end of GPIB_LISTENER_SETTLE_US and again one
+ * GPIB_LISTENER_SETTLE_US later, and must be asserted both times. An
+ * address without listener costs only a couple of microseconds, as the
+ * wait ends when NDAC is released. Ends with UNL.
+ */
+bool GPIBbus::findListener(uint8_t pri, uint8_t firstSec, uint8_t lastSec, bool *found) {
+  *found = false;
+  if (pri > 30) return ERR;
+
+  // Untalk as well: a talker left addressed could otherwise send a byte once ATN is released
+  if (sendCmd(GC_UNL)) return ERR;
+  if (sendCmd(GC_UNT)) return ERR;
+  if (sendCmd(GC_LAD + pri)) return ERR;
+  if (firstSec != 0xFF) {
+    for (uint8_t sec = firstSec; sec <= lastSec; sec++) {
+      if (sendCmd(sec)) return ERR;
+    }
+  }
+
+  // Release ATN and wait for the devices that are not addressed to release NDAC.
+  // NDAC must be asserted at the end of the window and still one window later,
+  // so that a slow device that is not addressed is not taken for a listener.
+  clearSignal(ATN_BIT);
+  *found = true;
+  for (uint8_t i = 0; (i < 2) && *found; i++) {
+    unsigned long startMicros = micros();
+    while (isAsserted(NDAC_PIN) && ((unsigned long)(micros() - startMicros) < GPIB_LISTENER_SETTLE_US)) {
+    }
+    *found = isAsserted(NDAC_PIN);
+  }
+  if (firstSec == 0xFF) {
+    if (*found) {
+      knownDevices |= (1UL << pri);
+    } else {
+      knownDevices &= ~(1UL << pri);
+    }
+  }
+
+  // ATN again (sendCmd() does not do it, as the state is still CCMS), and unlisten
+  setControls(CCMS);
+  if (sendCmd(GC_UNL)) return ERR;
+  setControls(CIDS);
+  return OK;
+}
+
+
 /***** Send a TCT (Take Control) command *****/
 bool GPIBbus::sendTCT(uint8_t addr){
  #ifdef DEBUG_GPIB_COMMANDS
@@ -506,6 +645,10 @@ bool GPIBbus::sendUNL() {
 bool GPIBbus::sendCmd(uint8_t cmdByte) {
   enum gpibHandshakeStates state;
 
+  // Addressing commands sent directly (and DCL) make the addressing cache invalid.
+  // addressDevice() sets the cache again after sending its commands.
+  if ((cmdByte >= GC_LAD) || (cmdByte == GC_DCL)) clearAddressCache();
+
   // Set lines for command and assert ATN
   if (cstate != CCMS) setControls(CCMS);
   // Send the command
@@ -528,19 +671,45 @@ bool GPIBbus::sendCmd(uint8_t cmdByte) {
  * 7 - command received via serial
  */
 bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte, uint8_t endByte) {
+  enum receiveEndReasons reason;
+  size_t len;
+  return receiveBytes(&dataStream, NULL, 0, &len, detectEoi, detectEndByte, endByte, &reason);
+}
+
+
+/***** Receive at most maxBytes of data from the GPIB bus directly into a buffer *****/
+/*
+ * When maxBytes have been received before the end of the transmission,
+ * the reason is set to RX_COUNT and in controller mode the lines are left
+ * in the listener state, so that the talker holds the rest of its data
+ * until the next call continues the transfer.
+ */
+bool GPIBbus::receiveData(uint8_t *buf, size_t maxBytes, size_t *len, bool detectEoi, bool detectEndByte, uint8_t endByte, enum receiveEndReasons *reason) {
+  return receiveBytes(NULL, buf, maxBytes, len, detectEoi, detectEndByte, endByte, reason);
+}
+
+
+/***** Receive data from the GPIB bus into a stream or, when dataStream is NULL, into buf *****/
+bool GPIBbus::receiveBytes(Stream *dataStream, uint8_t *buf, size_t maxBytes, size_t *len, bool detectEoi, bool detectEndByte, uint8_t endByte, enum receiveEndReasons *reason) {
 
   uint8_t bytes[3] = { 0 };  // Received byte buffer
   uint8_t eor = cfg.eor & 7;
-  int x = 0;
+  size_t x = 0;
   bool readWithEoi = false;
   bool eoiDetected = false;
   enum gpibHandshakeStates state = HANDSHAKE_COMPLETE;
 
+  *reason = RX_END;
+
   endByte = endByte;  // meaningless but defeats vcompiler warning!
 
   // Reset transmission break flag
   txBreak = false;
 
+  // The timeout applies to the whole transfer
+  ioStartMillis = millis();
+  ioTimed = true;
+
   // EOI detection required ?
   if (cfg.eoi || detectEoi || (cfg.eor == 7)) readWithEoi = true;  // Use EOI as terminator
 
@@ -577,44 +746,76 @@ bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte
   // Ready the data bus
   readyGpibDbus();
 
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+  unsigned long startMicros = micros();
+  unsigned long firstMicros = startMicros;
+#endif
+
   // Perform read of data (r=0: data read OK; r>0: GPIB read error);
   while (state == HANDSHAKE_COMPLETE) {
 
     // txBreak > 0 indicates break condition
     if (txBreak) break;
 
+#ifdef GPIB_BLOCK_TRANSFER
+    if (cfg.cmode == 2) {
+      // Controller mode: ATN is ours, so read with the fast handshake
+      state = readDataByte(&bytes[0], readWithEoi, &eoiDetected);
+    } else {
+#endif
+
     // ATN asserted
     if (isAsserted(ATN_PIN)) break;
 
     // Read the next character on the GPIB bus
     state = readByte(&bytes[0], readWithEoi, &eoiDetected);
 
+#ifdef GPIB_BLOCK_TRANSFER
+    }
+#endif
+
 
     // If IFC or ATN asserted then break here
     if ((state == IFC_ASSERTED) || (state == ATN_ASSERTED)) break;
 
     // If successfully received character
     if (state == HANDSHAKE_COMPLETE) {
+      if (dataStream) {
 #ifdef DEBUG_GPIBbus_RECEIVE
-      DB_HEX_PRINT(bytes[0]);
+        DB_HEX_PRINT(bytes[0]);
 #else
-      // Output the character to the serial port
-      dataStream.print((char)bytes[0]);
+        // Output the character to the serial port
+        dataStream->print((char)bytes[0]);
 #endif
+      } else {
+        // Store the character in the buffer
+        buf[x] = bytes[0];
+      }
 
       // Byte counter
       x++;
 
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+      if (x == 1) firstMicros = micros();
+#endif
+
       // EOI detection enabled and EOI detected?
-      if (readWithEoi) {
-        if (eoiDetected) break;
-      } else {
-        // Has a termination sequence been found ?
-        if (detectEndByte) {
-          if (bytes[0] == endByte) break;
-        } else {
-          if (isTerminatorDetected(bytes, eor)) break;
+      if (readWithEoi && eoiDetected) break;
+
+      // Has a termination sequence been found ? The end byte also ends a transfer that ends with EOI.
+      if (detectEndByte) {
+        if (bytes[0] == endByte) {
+          *reason = RX_ENDBYTE;
+          break;
         }
+      } else if (!readWithEoi) {
+        if (isTerminatorDetected(bytes, eor)) break;
+      }
+
+      // Requested number of bytes received?
+      if (maxBytes && (x >= maxBytes)) {
+        *reason = RX_COUNT;
+        break;
       }
 
       // Shift last three bytes in memory
@@ -626,6 +827,10 @@ bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte
     }
   }
 
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+  printThroughput(x, startMicros, firstMicros);
+#endif
+
 #ifdef DEBUG_GPIBbus_RECEIVE
   DB_RAW_PRINTLN();
   DB_PRINT(F("After loop flags:"), "");
@@ -641,9 +846,12 @@ bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte
     DB_PRINT(F("EOI detected!"), "");
 #endif
     // If eot_enabled then add EOT character
-    if (cfg.eot_en) dataStream.print(cfg.eot_ch);
+    if (cfg.eot_en && dataStream) dataStream->print(cfg.eot_ch);
   }
 
+  // End of the transfer: send what the stream may have buffered
+  if (dataStream) dataStream->flush();
+
   // Verbose timeout error
 #ifdef DEBUG_GPIBbus_RECEIVE
   if (state != HANDSHAKE_COMPLETE) {
@@ -663,8 +871,8 @@ bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte
 #endif
     }
 */
-    // Set controller back to idle state
-    setControls(CIDS);
+    // Set controller back to idle state, unless the transfer is to be continued
+    if (*reason != RX_COUNT) setControls(CIDS);
 
   } else {
     // Set device back to idle state
@@ -674,6 +882,9 @@ bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte
   // Reset break flag
   if (txBreak) txBreak = false;
 
+  *len = x;
+  ioTimed = false;
+
 #ifdef DEBUG_GPIBbus_RECEIVE
   DB_PRINT(F("done."), "");
 #endif
@@ -687,10 +898,28 @@ bool GPIBbus::receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte
 
 
 /***** Send a series of characters as data to the GPIB bus *****/
-void GPIBbus::sendData(const char *data, uint8_t dsize) {
+bool GPIBbus::sendData(const char *data, size_t dsize) {
+  return sendData(data, dsize, true);
+}
+
+
+/***** Send a chunk of a series of characters as data to the GPIB bus *****/
+/*
+ * Terminators and EOI are only sent after the last chunk. The caller
+ * leaves the listener addressed until the last chunk has been sent.
+ */
+bool GPIBbus::sendData(const char *data, size_t dsize, bool isLastChunk) {
   //  bool err = false;
   uint8_t tc;
-  enum gpibHandshakeStates state;
+  enum gpibHandshakeStates state = HANDSHAKE_COMPLETE;
+  bool eoi = cfg.eoi && isLastChunk;
+
+  // Reset transmission break flag
+  txBreak = false;
+
+  // The timeout applies to the whole transfer
+  ioStartMillis = millis();
+  ioTimed = true;
 
   switch (cfg.eos) {
     case 1:
@@ -703,6 +932,7 @@ void GPIBbus::sendData(const char *data, uint8_t dsize) {
     default:
       tc = 2;
   }
+  if (!isLastChunk) tc = 0;
   // Set control pins for writing data (ATN unasserted)
   if (cfg.cmode == 2) {
     setControls(CTAS);
@@ -715,33 +945,50 @@ void GPIBbus::sendData(const char *data, uint8_t dsize) {
   DB_PRINT(F("Begin send loop ->"), "");
 #endif
 
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+  unsigned long startMicros = micros();
+  unsigned long firstMicros = startMicros;
+#endif
+
   // Write the data string
-  for (int i = 0; i < dsize; i++) {
+  for (size_t i = 0; i < dsize; i++) {
 
-    // If EOI asserting is on
-    if (cfg.eoi) {
-      // Send all characters
-      if (tc) {
-        state = writeByte(data[i], NO_EOI);  // Just send the character - EOI will be sent with the terminator
-      } else {
-        state = writeByte(data[i], (i == (dsize - 1)));  // Send EOI on last character
-      }
+    // Send EOI on last character if EOI asserting is on, unless EOI will be sent with the terminator
+    // Note: there is no filter on non-escaped CR, LF and ESC, as it affects read of HP3478A cal data
+    bool isLastByte = eoi && !tc && (i == (dsize - 1));
+
+#ifdef GPIB_BLOCK_TRANSFER
+    if (cfg.cmode == 2) {
+      // Controller mode: send with the fast handshake
+      state = writeDataByte(data[i], isLastByte);
     } else {
-      // Otherwise ignore non-escaped CR, LF and ESC
-      // Filter REMOVED as it afftects read of HP3478A cal dataf
-      // if ((data[i] != CR) && (data[i] != LF) && (data[i] != ESC)) state = writeByte(data[i], NO_EOI);
-      // Filter REMOVED as it affects read of HP3478A cal data
-      // 
-      state = writeByte(data[i], NO_EOI);
+      state = writeByte(data[i], isLastByte);
     }
+#else
+    state = writeByte(data[i], isLastByte);
+#endif
 
 #ifdef DEBUG_GPIBbus_SEND
     DB_RAW_PRINT(data[i]);
 #endif
 
     if (state != HANDSHAKE_COMPLETE) break;
+
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+    if (i == 0) firstMicros = micros();
+#endif
+
+    // txBreak > 0 indicates break condition
+    if (txBreak) {
+      state = HANDSHAKE_START;
+      break;
+    }
   }
 
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+  printThroughput(dsize, startMicros, firstMicros);
+#endif
+
 #ifdef DEBUG_GPIBbus_SEND
   DB_PRINT(F("<- End of send loop."), "");
 #endif
@@ -750,13 +997,13 @@ void GPIBbus::sendData(const char *data, uint8_t dsize) {
   if ((state == HANDSHAKE_COMPLETE) && tc) {
     switch (cfg.eos) {
       case 1:
-        writeByte(CR, cfg.eoi);
+        state = writeByte(CR, cfg.eoi);
 #ifdef DEBUG_GPIBbus_SEND
         DB_PRINT(F("appended CR"), (cfg.eoi ? " with EOI" : ""));
 #endif
         break;
       case 2:
-        writeByte(LF, cfg.eoi);
+        state = writeByte(LF, cfg.eoi);
 #ifdef DEBUG_GPIBbus_SEND
         DB_PRINT(F("appended LF"), (cfg.eoi ? " with EOI" : ""));
 #endif
@@ -764,8 +1011,8 @@ void GPIBbus::sendData(const char *data, uint8_t dsize) {
       case 3:
         break;
       default:
-        writeByte(CR, NO_EOI);
-        writeByte(LF, cfg.eoi);
+        state = writeByte(CR, NO_EOI);
+        if (state == HANDSHAKE_COMPLETE) state = writeByte(LF, cfg.eoi);
 #ifdef DEBUG_GPIBbus_SEND
         DB_PRINT(F("appended CRLF"), (cfg.eoi ? " with EOI" : ""));
 #endif
@@ -779,10 +1026,13 @@ void GPIBbus::sendData(const char *data, uint8_t dsize) {
     // Set control lines to idle
     setControls(DIDS);
   }
+  ioTimed = false;
 
 #ifdef DEBUG_GPIBbus_SEND
   DB_PRINT(F("done."), "");
 #endif
+
+  return (state == HANDSHAKE_COMPLETE) ? OK : ERR;
 }
 
 
@@ -808,6 +1058,52 @@ void GPIBbus::signalBreak() {
 }
 
 
+/***** Set the timeout for the following transfers *****/
+/*
+ * Overrides cfg.rtmo without changing the configuration, e.g. for the
+ * timeout that comes with a network request. Unlike cfg.rtmo, which
+ * applies to each handshake step, it applies to each receiveData() or
+ * sendData() as a whole, and to each step of the other commands.
+ * 0 returns to cfg.rtmo.
+ */
+void GPIBbus::setTimeout(unsigned long tmo) {
+  ioTimeout = tmo;
+}
+
+
+/***** Handshake timeout in use *****/
+/*
+ * During a transfer with ioTimeout, a step gets what is left of it.
+ */
+unsigned long GPIBbus::getTimeout() {
+  if (!ioTimeout) return cfg.rtmo;
+  if (!ioTimed) return ioTimeout;
+  unsigned long elapsed = millis() - ioStartMillis;
+  return (elapsed < ioTimeout) ? (ioTimeout - elapsed) : 0;
+}
+
+
+/***** Set a function to call while waiting for the bus *****/
+/*
+ * The callback lets the application service other work (e.g. an abort
+ * request from the network) during a long transfer. It is called at most
+ * once per millisecond from the handshake wait loops. It must not use the
+ * GPIB bus, but it may call signalBreak() to end the transfer.
+ */
+void GPIBbus::setIdleCallback(void (*callback)()) {
+  idleCallback = callback;
+}
+
+
+/***** Call the idle callback, at most once per millisecond *****/
+void GPIBbus::idle(unsigned long now) {
+  if (idleCallback && (now != idleMillis)) {
+    idleMillis = now;
+    idleCallback();
+  }
+}
+
+
 /***** Control the GPIB bus - set various GPIB states *****/
 /*
  * state is a predefined state (CINI, CIDS, CCMS, CLAS, CTAS, DINI, DIDS, DLAS, DTAS);
@@ -989,7 +1285,7 @@ bool GPIBbus::unAddressDevice() {
   // Clear secondary address
 //  cfg.saddr = 0xFF;
   // Clear flag
-  deviceAddressed = TONONE;
+  clearAddressCache();
 #ifdef DEBUG_GPIBbus_DEVICE
   DB_PRINT(F("done."), "");
 #endif
@@ -998,14 +1294,27 @@ bool GPIBbus::unAddressDevice() {
 
 
 /***** Untalk bus then address a device *****/
+/*
+ * Only sends the addressing commands needed to get from the currently
+ * addressed device and direction to the requested one: nothing when
+ * they are the same, UNL or UNT when only the direction changes.
+ */
 bool GPIBbus::addressDevice(uint8_t pri, uint8_t sec=0xFF, uint8_t dir=TOLISTEN) {
 
   if (pri>30) return ERR;
 
   if ( sec<0x60 || (sec>0x7E && sec!=0xFF) ) return ERR;
 
-  if (sendCmd(GC_UNL)) return ERR;
-  if (sendCmd(GC_UNT)) return ERR;
+  // Already addressed as requested?
+  if ((deviceAddressed == dir) && (addressedPri == pri) && (addressedSec == sec)) return OK;
+
+  if ((deviceAddressed != TONONE) && (addressedPri == pri) && (addressedSec == sec)) {
+    // Same device, other direction: only remove it from its current role
+    if (sendCmd((deviceAddressed == TOLISTEN) ? GC_UNL : GC_UNT)) return ERR;
+  } else {
+    if (sendCmd(GC_UNL)) return ERR;
+    if (sendCmd(GC_UNT)) return ERR;
+  }
 
 //Serial.println(F("Addressing..."));
 #ifdef DEBUG_GPIBbus_DEVICE
@@ -1016,36 +1325,45 @@ bool GPIBbus::addressDevice(uint8_t pri, uint8_t sec=0xFF, uint8_t dir=TOLISTEN)
   if (dir == TOTALK) {
     // Device to talk, controller to listen
     if (sendCmd(GC_TAD + pri)) return ERR;
-    // Secondary address?
-    if (sec != 0xFF) {
-      if (sendCmd(sec)) return ERR;
-    }
-    deviceAddressed = TOTALK;
   } else {
     // Device to listen, controller to talk
     if (sendCmd(GC_LAD + pri)) return ERR;
-    // Secondary address?
-    if (sec != 0xFF) {
-      if (sendCmd(sec)) return ERR;
-    }
-    deviceAddressed = TOLISTEN;
+  }
+  // Secondary address?
+  if (sec != 0xFF) {
+    if (sendCmd(sec)) return ERR;
   }
 
   // Set flag
-//  deviceAddressed = true;
+  deviceAddressed = (dir == TOTALK) ? TOTALK : TOLISTEN;
+  addressedPri = pri;
+  addressedSec = sec;
   return OK;
 }
 
 
 /***** Return status device addressing (Controller mode) *****/
 /*
- * true = device has been addressed; false = device has not been addressed
+ * TONONE = no device has been addressed; TOLISTEN/TOTALK = direction in which the device has been addressed
  */
-bool GPIBbus::haveAddressedDevice() {
+uint8_t GPIBbus::haveAddressedDevice() {
   return deviceAddressed;
 }
 
 
+/***** Forget which device is addressed *****/
+/*
+ * Call after anything that changes the addressing state of the bus
+ * behind the back of addressDevice() (IFC, DCL, raw addressing commands).
+ * The next addressDevice() will then send the full addressing sequence.
+ */
+void GPIBbus::clearAddressCache() {
+  deviceAddressed = TONONE;
+  addressedPri = 0xFF;
+  addressedSec = 0xFF;
+}
+
+
 /***** Device is addressed to listen? (Device mode) *****/
 bool GPIBbus::isDeviceAddressedToListen() {
   if (cstate == DLAS) return true;
@@ -1082,7 +1400,7 @@ enum gpibHandshakeStates GPIBbus::readByte(uint8_t *db, bool readWithEoi, bool *
 
   unsigned long startMillis = millis();
   unsigned long currentMillis = startMillis + 1;
-  const unsigned long timeval = cfg.rtmo;
+  const unsigned long timeval = getTimeout();
   enum gpibHandshakeStates gpibState = HANDSHAKE_START;
 
   bool atnStat = isAsserted(ATN_PIN);  // Capture state of ATN
@@ -1145,6 +1463,10 @@ enum gpibHandshakeStates GPIBbus::readByte(uint8_t *db, bool readWithEoi, bool *
 
     // Increment time
     currentMillis = millis();
+
+    // Let the application run, and stop when it has signalled a break
+    idle(currentMillis);
+    if (txBreak) break;
   }
 
   // Otherwise return stage
@@ -1163,7 +1485,7 @@ enum gpibHandshakeStates GPIBbus::readByte(uint8_t *db, bool readWithEoi, bool *
 enum gpibHandshakeStates GPIBbus::writeByte(uint8_t db, bool isLastByte) {
   unsigned long startMillis = millis();
   unsigned long currentMillis = startMillis + 1;
-  const unsigned long timeval = cfg.rtmo;
+  const unsigned long timeval = getTimeout();
   enum gpibHandshakeStates gpibState = HANDSHAKE_START;
 
   // Wait for interval to expire
@@ -1232,6 +1554,10 @@ enum gpibHandshakeStates GPIBbus::writeByte(uint8_t db, bool isLastByte) {
 
     // Increment time
     currentMillis = millis();
+
+    // Let the application run, and stop when it has signalled a break
+    idle(currentMillis);
+    if (txBreak) break;
   }
 
   // Handshake complete
@@ -1272,6 +1598,280 @@ enum gpibHandshakeStates GPIBbus::writeByte(uint8_t db, bool isLastByte) {
 }
 
 
+#ifdef GPIB_BLOCK_TRANSFER
+/***** Wait for a handshake signal to reach a state *****/
+/*
+ * Spins on the pin and only samples the timer (and calls the idle callback)
+ * every 256 polls, i.e. when the bus stalls. Returns false on timeout
+ * (see getTimeout()) or break.
+ */
+bool GPIBbus::waitForPinState(uint8_t pin, uint8_t state) {
+  unsigned long startMillis = 0;
+  bool stalled = false;
+  uint8_t polls = 0;
+
+  while (getGpibPinState(pin) != state) {
+    if (++polls == 0) {
+      unsigned long now = millis();
+      if (!stalled) {
+        startMillis = now;
+        stalled = true;
+      } else if ((unsigned long)(now - startMillis) >= getTimeout()) {
+        return false;
+      }
+      // Let the application run, and stop when it has signalled a break
+      idle(now);
+      if (txBreak) return false;
+    }
+  }
+  return true;
+}
+
+
+/***** Read a data byte in controller mode (fast handshake) *****/
+/*
+ * Same handshake as readByte() without the state machine and without
+ * the device mode IFC/ATN checks. Returns the stage at which it failed.
+ */
+enum gpibHandshakeStates GPIBbus::readDataByte(uint8_t *db, bool readWithEoi, bool *eoi) {
+  *eoi = false;
+
+  // Unassert NRFD (we are ready for more data)
+  clearSignal(NRFD_BIT);
+  // Wait for DAV to go LOW indicating talker has finished setting data lines
+  if (!waitForPinState(DAV_PIN, LOW)) return WAIT_FOR_DATA;
+  // Assert NRFD (Busy reading data)
+  assertSignal(NRFD_BIT);
+  // Check for EOI signal
+  if (readWithEoi && (getGpibPinState(EOI_PIN) == LOW)) *eoi = true;
+  // read from DIO
+  *db = readGpibDbus();
+  // Unassert NDAC signalling data accepted
+  clearSignal(NDAC_BIT);
+  // Wait for DAV to go HIGH indicating data no longer valid (i.e. transfer complete)
+  if (!waitForPinState(DAV_PIN, HIGH)) return DATA_ACCEPTED;
+  // Re-assert NDAC - handshake complete, ready to accept data again
+  assertSignal(NDAC_BIT);
+  return HANDSHAKE_COMPLETE;
+}
+
+
+/***** Write a data byte in controller mode (fast handshake) *****/
+/*
+ * Same handshake as writeByte() without the state machine and without
+ * the device mode IFC/ATN checks. Returns the stage at which it failed.
+ */
+enum gpibHandshakeStates GPIBbus::writeDataByte(uint8_t db, bool isLastByte) {
+  // Wait for NDAC to go LOW (listeners present)
+  if (!waitForPinState(NDAC_PIN, LOW)) return HANDSHAKE_START;
+  // Wait for NRFD to go HIGH (indicating that receiver is ready)
+  if (!waitForPinState(NRFD_PIN, HIGH)) return WAIT_FOR_RECEIVER_READY;
+  // Place data on the bus and assert DAV, plus EOI on the last byte
+  setGpibDbus(db);
+  assertSignal(isLastByte ? (DAV_BIT | EOI_BIT) : DAV_BIT);
+  // Wait for NRFD to go LOW (receiver accepting data)
+  if (!waitForPinState(NRFD_PIN, LOW)) return DATA_READY;
+  // Wait for NDAC to go HIGH (data accepted)
+  if (!waitForPinState(NDAC_PIN, HIGH)) return RECEIVER_ACCEPTING;
+  // Unassert DAV (and EOI) and reset the data bus
+  clearSignal(isLastByte ? (DAV_BIT | EOI_BIT) : DAV_BIT);
+  setGpibDbus(0);
+  return HANDSHAKE_COMPLETE;
+}
+#endif
+
+
+#ifdef GPIB_INTERRUPT_RECEIVE
+/***** Receive in the background *****/
+/*
+ * The DAV pin change interrupt does the listener handshake of each byte
+ * and puts the byte in a FIFO. When the FIFO is full, NRFD stays asserted
+ * until receiveBackground() has made room. After a byte with EOI (when
+ * reading with EOI), no more bytes are accepted.
+ */
+static volatile uint8_t rxFifo[GPIB_RX_FIFO_SIZE];
+static volatile uint8_t rxHead;       // Next free position, written by the interrupt
+static volatile uint8_t rxTail;       // Next byte to take, written by receiveBackground()
+static volatile bool rxDataValid;     // DAV asserted and byte taken, waiting for DAV to go HIGH
+static volatile bool rxEoi;           // Byte with EOI received, the transfer has ended
+static volatile bool rxHeld;          // NRFD kept asserted because the FIFO was full
+static bool rxWithEoi;                // EOI ends the transfer
+
+
+/***** DAV pin change interrupt *****/
+static void davChanged() {
+  if (getGpibPinState(DAV_PIN) == LOW) {
+    if (rxDataValid) return;
+    // Assert NRFD (Busy reading data)
+    setGpibCtrlState(0, NRFD_BIT);
+    // Check for EOI signal
+    if (rxWithEoi && (getGpibPinState(EOI_PIN) == LOW)) rxEoi = true;
+    // read from DIO
+    rxFifo[rxHead] = readGpibDbus();
+    rxHead = (rxHead + 1) % GPIB_RX_FIFO_SIZE;
+    rxDataValid = true;
+    // Unassert NDAC signalling data accepted
+    setGpibCtrlState(NDAC_BIT, NDAC_BIT);
+  } else {
+    if (!rxDataValid) return;
+    rxDataValid = false;
+    // Re-assert NDAC - handshake complete
+    setGpibCtrlState(0, NDAC_BIT);
+    // Unassert NRFD when there is room for the next byte
+    if (!rxEoi && ((rxHead + 1) % GPIB_RX_FIFO_SIZE) != rxTail) {
+      setGpibCtrlState(NRFD_BIT, NRFD_BIT);
+    } else {
+      rxHeld = true;
+    }
+  }
+}
+
+
+/***** Start receiving in the background *****/
+/*
+ * Controller mode only, with the talker already addressed. The bytes are
+ * collected with receiveBackground(). Nothing else may use the bus until
+ * stopBackgroundReceive() (or until receiveBackground() reports the end).
+ */
+bool GPIBbus::startBackgroundReceive(bool detectEoi) {
+  if (cfg.cmode != 2) return ERR;
+  if (bgReceiving) return OK;
+
+  rxWithEoi = (cfg.eoi || detectEoi || (cfg.eor == 7));
+  rxHead = 0;
+  rxTail = 0;
+  rxDataValid = false;
+  rxEoi = false;
+  rxHeld = false;
+
+  // Set GPIB control lines to controller read mode (NRFD and NDAC asserted)
+  setControls(CLAS);
+  readyGpibDbus();
+
+  bgReceiving = true;
+  attachInterrupt(digitalPinToInterrupt(DAV_PIN), davChanged, CHANGE);
+  // Unassert NRFD (we are ready for data)
+  clearSignal(NRFD_BIT);
+  return OK;
+}
+
+
+/***** Pass the bytes received in the background to a stream *****/
+/*
+ * Returns true when the transfer has ended (EOI), in which case the
+ * controller is back in idle state, as after receiveData().
+ */
+bool GPIBbus::receiveBackground(Stream &dataStream) {
+  if (!bgReceiving) return true;
+
+  while (rxTail != rxHead) {
+    dataStream.print((char)rxFifo[rxTail]);
+    rxTail = (rxTail + 1) % GPIB_RX_FIFO_SIZE;
+  }
+
+  // The FIFO has room again
+  noInterrupts();
+  if (rxHeld && !rxEoi) {
+    rxHeld = false;
+    clearSignal(NRFD_BIT);
+  }
+  interrupts();
+
+  // Ended with EOI, and the handshake of the last byte is complete
+  if (rxEoi && !rxDataValid && (rxTail == rxHead)) {
+    // If eot_enabled then add EOT character
+    if (cfg.eot_en) dataStream.print(cfg.eot_ch);
+    dataStream.flush();
+    stopBackgroundReceive();
+    return true;
+  }
+  return false;
+}
+
+
+/***** End the handshake in the background *****/
+/*
+ * Assert NRFD before detaching the interrupt: a talker that has not yet
+ * asserted DAV then waits, and its byte is not sent. A byte that has been
+ * taken (NDAC released) is completed: wait for DAV to go HIGH, then assert
+ * NDAC, as the interrupt would have done.
+ */
+void GPIBbus::haltBackgroundReceive() {
+  noInterrupts();
+  assertSignal(NRFD_BIT);
+  detachInterrupt(digitalPinToInterrupt(DAV_PIN));
+  interrupts();
+
+  if (rxDataValid) {
+    unsigned long startMillis = millis();
+    while (isAsserted(DAV_PIN) && ((unsigned long)(millis() - startMillis) < getTimeout())) {
+    }
+    assertSignal(NDAC_BIT);
+    rxDataValid = false;
+  }
+
+  bgReceiving = false;
+  // Set controller back to idle state
+  setControls(CIDS);
+}
+
+
+/***** Stop receiving in the background *****/
+/*
+ * NRFD is asserted and the interrupt detached first, so that no byte is
+ * accepted from then on. The handshake of a byte that has already been
+ * taken is completed, and the bytes still in the FIFO are passed on to
+ * dataStream, so that nothing the talker has sent is lost.
+ */
+void GPIBbus::stopBackgroundReceive(Stream &dataStream) {
+  if (!bgReceiving) return;
+  haltBackgroundReceive();
+
+  while (rxTail != rxHead) {
+    dataStream.print((char)rxFifo[rxTail]);
+    rxTail = (rxTail + 1) % GPIB_RX_FIFO_SIZE;
+  }
+  // Ended with EOI: add the EOT character, as receiveBackground() does
+  if (rxEoi && cfg.eot_en) dataStream.print(cfg.eot_ch);
+  dataStream.flush();
+}
+
+
+/*
+ * As above, but the bytes still in the FIFO are dropped (e.g. when the bus
+ * is stopped).
+ */
+void GPIBbus::stopBackgroundReceive() {
+  if (!bgReceiving) return;
+  haltBackgroundReceive();
+}
+
+
+bool GPIBbus::isBackgroundReceiving() {
+  return bgReceiving;
+}
+#endif
+
+
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+/***** Print the throughput of a data transfer *****/
+/*
+ * The throughput is over the whole transfer, including the time the device
+ * takes to respond to the first byte. The cycles per byte are over the
+ * byte loop only: from the end of the handshake of the first byte to the
+ * end of that of the last byte.
+ */
+void GPIBbus::printThroughput(size_t bytes, unsigned long startMicros, unsigned long firstMicros) {
+  unsigned long endMicros = micros();
+  unsigned long elapsed = endMicros - startMicros;
+  if (elapsed == 0) elapsed = 1;
+  DB_PRINT(F("Bytes transferred: "), bytes);
+  DB_PRINT(F("Throughput, whole transfer (bytes/s): "), (unsigned long)((uint64_t)bytes * 1000000UL / elapsed));
+  if (bytes > 1) DB_PRINT(F("CPU cycles per byte, byte loop: "), (unsigned long)((uint64_t)(endMicros - firstMicros) * (F_CPU / 1000000UL) / (bytes - 1)));
+}
+#endif
+
+
 /***** ^^^^^^^^^^^^^^^^^^^^^^^^^^^ *****/
 /***** GPIB CLASS PUBLIC FUNCTIONS *****/
 /***************************************/
@@ -1288,6 +1888,63 @@ enum gpibHandshakeStates GPIBbus::writeByte(uint8_t db, bool isLastByte) {
 /********** PRIVATE FUNCTIONS **********/
 
 
+/***** Start a serial poll sequence *****/
+/*
+ * Unlisten all, enable serial poll. The controller listens without being
+ * addressed (as in addressDevice()): cfg.caddr is not always the address
+ * of the controller (in the VXI build it is the default instrument).
+ */
+bool GPIBbus::beginSerialPoll() {
+  if (sendCmd(GC_UNL)) return ERR;
+  if (sendCmd(GC_SPE)) return ERR;
+  return OK;
+}
+
+
+/***** Read the status byte of a device, in a serial poll sequence *****/
+/*
+ * Also updates the known devices.
+ */
+enum gpibHandshakeStates GPIBbus::pollStatus(uint8_t pri, uint8_t sec, uint8_t *stb) {
+  enum gpibHandshakeStates state;
+  bool eoi = false;
+
+  // Device to talk
+  if (sendCmd(GC_TAD + pri)) return HANDSHAKE_START;
+  if (sec != 0xFF) {
+    if (sendCmd(sec)) return HANDSHAKE_START;
+  }
+
+  // Controller active listener (ATN unasserted), read the status byte without EOI detection
+  setControls(CLAS);
+  clearDataBus();
+  state = readByte(stb, false, &eoi);
+  setControls(CTAS);
+
+  if (sec == 0xFF) {
+    if (state == HANDSHAKE_COMPLETE) {
+      knownDevices |= (1UL << pri);
+    } else {
+      knownDevices &= ~(1UL << pri);
+    }
+  }
+  return state;
+}
+
+
+/***** End a serial poll sequence *****/
+/*
+ * Disable serial poll, unaddress, and back to idle state
+ */
+bool GPIBbus::endSerialPoll() {
+  if (sendCmd(GC_SPD)) return ERR;
+  if (sendCmd(GC_UNT)) return ERR;
+  if (sendCmd(GC_UNL)) return ERR;
+  setControls(CIDS);
+  return OK;
+}
+
+
 /***** Check for terminator *****/
 bool GPIBbus::isTerminatorDetected(uint8_t bytes[3], uint8_t eorSequence) {
   // Look for specified terminator (CR+LF by default)
@@ -110,6 +110,14 @@ enum gpibHandshakeStates {
 #define ALL_BITS (0xFF)
 
 
+/***** Reason for the end of a receiveData *****/
+enum receiveEndReasons {
+  RX_END,       // EOI or terminator detected, or transfer ended by timeout/break
+  RX_ENDBYTE,   // End byte detected
+  RX_COUNT      // Maximum number of bytes received, talker still active
+};
+
+
 enum operatingModes {
   OP_IDLE,
   OP_CTRL,
@@ -194,6 +202,10 @@ public:
   bool sendGET(uint8_t addr);
   bool sendSDC();
   bool sendTCT(uint8_t addr);
+  bool serialPoll(uint8_t pri, uint8_t sec, uint8_t *stb);
+  bool pollDevices(uint32_t devices, uint8_t *stb, uint32_t *rqs, bool stopOnRqs);
+  uint32_t getKnownDevices();
+  bool findListener(uint8_t pri, uint8_t firstSec, uint8_t lastSec, bool *found);
   void sendAllClear();
 
   bool sendUNT();
@@ -212,7 +224,9 @@ public:
   enum gpibHandshakeStates readByte(uint8_t *db, bool readWithEoi, bool *eoi);
   enum gpibHandshakeStates writeByte(uint8_t db, bool isLastByte);
   bool receiveData(Stream &dataStream, bool detectEoi, bool detectEndByte, uint8_t endByte);
-  void sendData(const char *data, uint8_t dsize);
+  bool receiveData(uint8_t *buf, size_t maxBytes, size_t *len, bool detectEoi, bool detectEndByte, uint8_t endByte, enum receiveEndReasons *reason);
+  bool sendData(const char *data, size_t dsize);
+  bool sendData(const char *data, size_t dsize, bool isLastChunk);
   void clearDataBus();
   void setControlVal(uint8_t value);
   void setDataVal(uint8_t value);
@@ -222,16 +236,53 @@ public:
   bool isDeviceInIdleState();
 
   void signalBreak();
+  void setIdleCallback(void (*callback)());
+  void setTimeout(unsigned long tmo);
+
+#ifdef GPIB_INTERRUPT_RECEIVE
+  bool startBackgroundReceive(bool detectEoi);
+  bool receiveBackground(Stream &dataStream);
+  void stopBackgroundReceive(Stream &dataStream);
+  void stopBackgroundReceive();
+  bool isBackgroundReceiving();
+#endif
 
   bool addressDevice(uint8_t pri, uint8_t sec, uint8_t dir);
   bool unAddressDevice();
-  bool haveAddressedDevice();
+  uint8_t haveAddressedDevice();
+  void clearAddressCache();
 
 private:
 
   bool txBreak;  // Signal to break the GPIB transmission
-  uint8_t deviceAddressed;
+  void (*idleCallback)();     // Called while waiting for the bus, see idle()
+  unsigned long idleMillis;   // Time of the last call of idleCallback
+  void idle(unsigned long now);
+  unsigned long ioTimeout;    // Timeout in ms that overrides cfg.rtmo, 0 = none, see setTimeout()
+  unsigned long ioStartMillis;  // Start of the transfer that ioTimeout applies to
+  bool ioTimed;               // A transfer with ioTimeout is in progress
+  unsigned long getTimeout();
+  uint8_t deviceAddressed;  // Direction in which the device below is addressed (TONONE, TOLISTEN, TOTALK)
+  uint8_t addressedPri;     // Primary address of the addressed device
+  uint8_t addressedSec;     // Secondary address of the addressed device (0xFF = none)
+#ifdef GPIB_INTERRUPT_RECEIVE
+  bool bgReceiving;         // The DAV interrupt is handling the handshake, see startBackgroundReceive()
+  void haltBackgroundReceive();
+#endif
+  uint32_t knownDevices;    // Bitmap of the primary addresses known to be on the bus
+  bool beginSerialPoll();
+  enum gpibHandshakeStates pollStatus(uint8_t pri, uint8_t sec, uint8_t *stb);
+  bool endSerialPoll();
   bool isTerminatorDetected(uint8_t bytes[3], uint8_t eorSequence);
+  bool receiveBytes(Stream *dataStream, uint8_t *buf, size_t maxBytes, size_t *len, bool detectEoi, bool detectEndByte, uint8_t endByte, enum receiveEndReasons *reason);
+#ifdef GPIB_BLOCK_TRANSFER
+  bool waitForPinState(uint8_t pin, uint8_t state);
+  enum gpibHandshakeStates readDataByte(uint8_t *db, bool readWithEoi, bool *eoi);
+  enum gpibHandshakeStates writeDataByte(uint8_t db, bool isLastByte);
+#endif
+#ifdef DEBUG_GPIBbus_THROUGHPUT
+  void printThroughput(size_t bytes, unsigned long startMicros, unsigned long firstMicros);
+#endif
 
   // Interrupt flag for MCP23S17
 #ifdef AR488_MCP23S17
@@ -241,4 +292,28 @@ private:
 };
 
 
+#ifdef AR488_CUSTOM
+/***** Assert an individual or group of signals *****/
+// Inline, so that a constant signal is a single store to PORTC.OUTCLR (see setGpibCtrlState())
+inline void GPIBbus::assertSignal(uint8_t sig) {
+  // Note: GPIO pin direction assumed set by setOperatingMode()
+  setGpibCtrlState(0, sig);   // Set all signals permitted by mask to LOW (asserted)
+}
+
+
+/***** Clear (unassert) an individual or group of signals *****/
+inline void GPIBbus::clearSignal(uint8_t sig) {
+  // Note: GPIO pin direction assumed set by setOperatingMode()
+  setGpibCtrlState(sig, sig);   // Set all signals permitted by mask to HIGH (unasserted)
+}
+
+
+/***** Detect selected pin state *****/
+// Inline, so that a constant pin is a single bit test (see getGpibPinState())
+inline bool GPIBbus::isAsserted(uint8_t gpibsig) {
+  return getGpibPinState(gpibsig) == LOW;
+}
+#endif
+
+
 #endif  // AR488_GPIBbus_H
@@ -1867,53 +1867,10 @@ void setGpibDbus(uint8_t db) {
 
 /***** Set the direction and state of the GPIB control lines ****/
 /*
-   Bits control lines as follows: 7-ATN_PIN, 6-SRQ_PIN, 5-REN_PIN, 4-EOI_PIN, 3-DAV_PIN, 2-NRFD_PIN, 1-NDAC_PIN, 0-IFC_PIN
-   state: 0=LOW; 1=HIGH/INPUT_PULLUP
-   dir  : 0=input; 1=output;
-   mode:  0=set pin state; 1=set pin direction
+   setGpibCtrlState() and setGpibCtrlDir() are inline in AR488_Layouts.h,
+   with the mapping of the control bits to PORTC resolved at compile time.
 */
 
-void setGpibState(uint8_t bits, uint8_t mask, uint8_t mode) {
-  uint8_t portCb = 0; // Output value for PORTC
-  uint8_t portCm = 0; // Mask for PORTC
-
-  // Map GPIB control bits to PORTC pins
-  portCb |= (bits & (1 << 0)) << 4; // IFC_PIN  (bit 0 -> PC4)
-  portCb |= (bits & (1 << 1)) << 2; // NDAC_PIN (bit 1 -> PC3)
-  portCb |= (bits & (1 << 2)) << 0; // NRFD_PIN (bit 2 -> PC2)
-  portCb |= (bits & (1 << 3)) >> 2; // DAV_PIN  (bit 3 -> PC1)
-  portCb |= (bits & (1 << 4)) >> 4; // EOI_PIN  (bit 4 -> PC0)
-  portCb |= (bits & (1 << 5)) << 2; // REN_PIN  (bit 5 -> PC7)
-  portCb |= (bits & (1 << 6)) >> 1; // SRQ_PIN  (bit 6 -> PC5)
-  portCb |= (bits & (1 << 7)) >> 1; // ATN_PIN  (bit 7 -> PC6)
-
-  portCm |= (mask & (1 << 0)) << 4; // IFC_PIN  (bit 0 -> PC4)
-  portCm |= (mask & (1 << 1)) << 2; // NDAC_PIN (bit 1 -> PC3)
-  portCm |= (mask & (1 << 2)) << 0; // NRFD_PIN (bit 2 -> PC2)
-  portCm |= (mask & (1 << 3)) >> 2; // DAV_PIN  (bit 3 -> PC1)
-  portCm |= (mask & (1 << 4)) >> 4; // EOI_PIN  (bit 4 -> PC0)
-  portCm |= (mask & (1 << 5)) << 2; // REN_PIN  (bit 5 -> PC7)
-  portCm |= (mask & (1 << 6)) >> 1; // SRQ_PIN  (bit 6 -> PC5)
-  portCm |= (mask & (1 << 7)) >> 1; // ATN_PIN  (bit 7 -> PC6)
-
-  switch (mode) {
-    case 0: // Set pin states
-      PORTC.OUT = (PORTC.OUT & ~portCm) | (portCb & portCm);
-      break;
-    case 1: // Set pin directions
-      PORTC.DIR = (PORTC.DIR & ~portCm) | (portCb & portCm);
-      break;
-  }
-}
-
-void setGpibCtrlDir(uint8_t bits, uint8_t mask) {
-  setGpibState(bits, mask, 1);
-};
-
-void setGpibCtrlState(uint8_t bits, uint8_t mask) {
-  setGpibState(bits, mask, 0);
-};
-
 #endif
 /***** ^^^^^^^^^^^^^^^^^^^^^^^^^ *****/
 /***** CUSTOM PIN LAYOUT SECTION *****/
@@ -1948,7 +1905,8 @@ void shiftEnable(bool stat){
 #endif
 
 
-#if not defined(AR488_MCP23S17)
+// The custom layout has an inline version in AR488_Layouts.h
+#if not defined(AR488_MCP23S17) && not defined(AR488_CUSTOM)
 
 uint8_t getGpibPinState(uint8_t pin){
   return digitalRead(pin);
@@ -21,6 +21,69 @@
 
 /***** Configured in AR488_Config.h *****/
 
+/***** Direct access to the control lines *****/
+/*
+ * The control lines are PC0 (EOI_PIN) to PC7 (REN_PIN), in the order of
+ * their pin numbers. They are read through VPORTC, so that a read with a
+ * constant pin compiles to a single bit test (SBIS/SBIC) instead of a
+ * call to digitalRead(). In a loop with a variable pin, the bit mask is
+ * computed once, outside of the loop.
+ */
+#define GPIB_CTRL_BIT(pin) (1 << ((pin) - EOI_PIN))
+
+inline uint8_t getGpibPinState(uint8_t pin) {
+  return (VPORTC.IN & GPIB_CTRL_BIT(pin)) ? HIGH : LOW;
+}
+
+/***** Map GPIB control bits to PORTC bits *****/
+/*
+ * Bits control lines as follows: 7-ATN_PIN, 6-SRQ_PIN, 5-REN_PIN, 4-EOI_PIN, 3-DAV_PIN, 2-NRFD_PIN, 1-NDAC_PIN, 0-IFC_PIN
+ * Resolved at compile time for constant bits, so that e.g. assertSignal(DAV_BIT)
+ * is a single store to PORTC.OUTCLR.
+ */
+constexpr uint8_t gpibCtrlToPortC(uint8_t bits) {
+  return ((bits & (1 << 0)) ? GPIB_CTRL_BIT(IFC_PIN)  : 0) |
+         ((bits & (1 << 1)) ? GPIB_CTRL_BIT(NDAC_PIN) : 0) |
+         ((bits & (1 << 2)) ? GPIB_CTRL_BIT(NRFD_PIN) : 0) |
+         ((bits & (1 << 3)) ? GPIB_CTRL_BIT(DAV_PIN)  : 0) |
+         ((bits & (1 << 4)) ? GPIB_CTRL_BIT(EOI_PIN)  : 0) |
+         ((bits & (1 << 5)) ? GPIB_CTRL_BIT(REN_PIN)  : 0) |
+         ((bits & (1 << 6)) ? GPIB_CTRL_BIT(SRQ_PIN)  : 0) |
+         ((bits & (1 << 7)) ? GPIB_CTRL_BIT(ATN_PIN)  : 0);
+}
+
+// Each control line must be on its own bit of PORTC
+#define GPIB_CTRL_ON_PORTC(pin) ((pin) >= EOI_PIN && (pin) <= EOI_PIN + 7)
+static_assert(GPIB_CTRL_ON_PORTC(IFC_PIN) && GPIB_CTRL_ON_PORTC(NDAC_PIN) && GPIB_CTRL_ON_PORTC(NRFD_PIN) &&
+              GPIB_CTRL_ON_PORTC(DAV_PIN) && GPIB_CTRL_ON_PORTC(EOI_PIN) && GPIB_CTRL_ON_PORTC(REN_PIN) &&
+              GPIB_CTRL_ON_PORTC(SRQ_PIN) && GPIB_CTRL_ON_PORTC(ATN_PIN), "GPIB control pins must be PC0..PC7");
+static_assert(gpibCtrlToPortC(0xFF) == 0xFF, "GPIB control pins must each have their own bit of PORTC");
+#ifdef PIN_PC0
+static_assert(EOI_PIN == PIN_PC0, "EOI_PIN must be PC0");
+#endif
+// The mapping itself is checked on the host, see SW/test_tools/ctrl_port_map
+
+
+/***** Set the state and direction of the GPIB control lines *****/
+/*
+ * state: 0=LOW; 1=HIGH/INPUT_PULLUP
+ * dir  : 0=input; 1=output;
+ * Only the lines in mask change. The tests on constant masks disappear at compile time.
+ */
+inline void setGpibCtrlState(uint8_t bits, uint8_t mask) {
+  uint8_t set = gpibCtrlToPortC(bits & mask);
+  uint8_t clr = gpibCtrlToPortC(~bits & mask);
+  if (clr) PORTC.OUTCLR = clr;
+  if (set) PORTC.OUTSET = set;
+}
+
+inline void setGpibCtrlDir(uint8_t bits, uint8_t mask) {
+  uint8_t set = gpibCtrlToPortC(bits & mask);
+  uint8_t clr = gpibCtrlToPortC(~bits & mask);
+  if (clr) PORTC.DIRCLR = clr;
+  if (set) PORTC.DIRSET = set;
+}
+
 #endif
 /***** ^^^^^^^^^^^^^^^^^^^^^^^^^ *****/
 /***** CUSTOM PIN LAYOUT SECTION *****/
@@ -2,93 +2,200 @@
 
 
 EthernetStream::EthernetStream()
-    : lastActivityTime(0), timeout(10000) {}
+    : current(&sessions[0]), timeout(10000) {
+    for (uint8_t i = 0; i < PROLOGIX_SESSIONS; i++) {
+        Session &s = sessions[i];
+        s.isNew = false;
+        s.rxPos = s.rxLen = 0;
+        s.txLen = 0;
+        s.txTime = 0;
+        s.lastActivityTime = 0;
+    }
+}
 
 
 bool EthernetStream::begin(uint32_t port) {
-        
+
     this->port = port;
     server = new EthernetServer(port);
     if (!server) return false;
 
     server->begin();
-    lastActivityTime = millis();
     return true;
 }
 
+/**
+ * @brief Direct the stream to the client of a session.
+ *
+ * All reads and writes go to that client until the next call.
+ * @param session the session, 0 .. PROLOGIX_SESSIONS-1
+ * @return true when the session has a client
+ */
+bool EthernetStream::select(uint8_t session) {
+    if (session >= PROLOGIX_SESSIONS) return false;
+    current = &sessions[session];
+    return connected();
+}
+
+/**
+ * @brief Check whether the selected session has a client.
+ */
+bool EthernetStream::connected() {
+    return current->client ? true : false;
+}
+
+/**
+ * @brief Check whether the client of the selected session is new.
+ *
+ * @return true once for each client, the first time it is asked
+ */
+bool EthernetStream::accepted() {
+    if (!current->isNew) return false;
+    current->isNew = false;
+    return true;
+}
+
+void EthernetStream::closeClient(Session &s) {
+    s.client.stop();
+    s.client = EthernetClient();
+    s.txLen = 0;  // nobody to send it to
+    s.rxPos = s.rxLen = 0;
+}
+
 void EthernetStream::checkClient() {
-    // This uses the 'server.available()' method. A client will become available once I have received data. 
-    // You can also only have one client this way
-    if (client && !client.connected()) {
-        client.stop();
-        client = EthernetClient();
+    // New clients are accepted in maintain(), here only the selected one is checked
+    if (current->client && !current->client.connected()) {
+        closeClient(*current);
     }
-    if (!client) {
-        client = server->available();
+    if (current->client) {
+        current->lastActivityTime = millis();
     }
-    if (client) {
-        lastActivityTime = millis();
+}
+
+/**
+ * @brief Fetch all received data that fits the receive buffer, in one block read.
+ *
+ * Only called when the buffer has been consumed.
+ * @return true when there is data in the buffer
+ */
+bool EthernetStream::fillBuffer() {
+    Session &s = *current;
+    s.rxPos = 0;
+    s.rxLen = 0;
+    if (s.client && s.client.available() > 0) {
+        int len = s.client.read(s.rxBuffer, sizeof(s.rxBuffer));
+        if (len > 0) {
+            s.rxLen = len;
+            s.lastActivityTime = millis();
+        }
     }
+    return s.rxLen > 0;
 }
 
 int EthernetStream::available() {
+    // data that is already here, without asking the network chip
+    if (current->rxPos < current->rxLen) return current->rxLen - current->rxPos;
     if (!server) return 0;
     checkClient();
-    if (!client) {
-        client = server->available();
-        if (client) {
-        }        
-    }
-    if (client) {
-        return client.available();
+    if (current->client) {
+        return current->client.available();
     }
     return 0;
 }
 
 int EthernetStream::read() {
+    if (current->rxPos < current->rxLen) return current->rxBuffer[current->rxPos++];
     checkClient();
-    if (client) {
-        return client.read();
+    if (fillBuffer()) {
+        return current->rxBuffer[current->rxPos++];
     }
     return -1;
 }
 
 int EthernetStream::peek() {
+    if (current->rxPos < current->rxLen) return current->rxBuffer[current->rxPos];
     checkClient();
-    if (client) {
-        return client.peek();
+    if (fillBuffer()) {
+        return current->rxBuffer[current->rxPos];
     }
     return -1;
 }
 
-void EthernetStream::flush() {
-    if (client) {
-        client.flush();
+/**
+ * @brief Send what is in the transmit buffer of a session, in one socket write.
+ */
+void EthernetStream::sendBuffer(Session &s) {
+    if (s.txLen > 0 && s.client) {
+        s.client.write(s.txBuffer, s.txLen);
     }
+    s.txLen = 0;
+}
+
+void EthernetStream::flush() {
+    // only hand the data to the socket, do not wait for it to be sent
+    sendBuffer(*current);
 }
 
 size_t EthernetStream::write(uint8_t b) {
-    if (client) {
-        buffer += static_cast<char>(b);
-        if (b == '\n') {
-            client.print(buffer);
-            buffer = "";
+    Session &s = *current;
+    if (s.client) {
+        s.txBuffer[s.txLen++] = b;
+        s.txTime = millis();
+        if (s.txLen == sizeof(s.txBuffer) || b == '\n') {
+            sendBuffer(s);
         }
         return 1;
     }
     return 0;
 }
 
+size_t EthernetStream::write(const uint8_t *buffer, size_t size) {
+    if (!current->client) return 0;
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+/**
+ * @brief Maintain the client connections of all sessions
+ *
+ * Sends what has been waiting in a transmit buffer for too long, closes idle and
+ * lost connections, and gives a new connection to a free session. When there is
+ * no free session, the new connection is closed right away.
+ * @return int the number of active clients
+ */
 int EthernetStream::maintain(void) {
     unsigned long currentMillis = millis();
-    if (client && (currentMillis - lastActivityTime > timeout)) {
-        client.stop();
-        client = EthernetClient();
+    int nrclients = 0;
+
+    for (uint8_t i = 0; i < PROLOGIX_SESSIONS; i++) {
+        Session &s = sessions[i];
+        if (s.txLen > 0 && (currentMillis - s.txTime > PROLOGIX_TX_IDLE)) {
+            sendBuffer(s);  // nothing more has come for a while
+        }
+        if (s.client && (!s.client.connected() || (currentMillis - s.lastActivityTime > timeout))) {
+            closeClient(s);
+        }
+        if (s.client) nrclients++;
     }
-    // TOOD: would it be better to just call checkClient?
-    if (client) {
-        return 1;
-    } else {
-        return 0;
+
+    if (server) {
+        EthernetClient newClient = server->accept();
+        if (newClient) {
+            for (uint8_t i = 0; i < PROLOGIX_SESSIONS; i++) {
+                Session &s = sessions[i];
+                if (!s.client) {
+                    s.client = newClient;
+                    s.isNew = true;
+                    s.rxPos = s.rxLen = 0;
+                    s.txLen = 0;
+                    s.lastActivityTime = currentMillis;
+                    return nrclients + 1;
+                }
+            }
+            newClient.stop();  // all sessions are in use
+        }
     }
+    return nrclients;
 }
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <Ethernet.h>
 #include <SPI.h>
+#include "config.h"
 
 class EthernetStream : public Stream {
 public:
@@ -11,23 +12,40 @@ public:
   
     bool begin(uint32_t port);
     int maintain(void);
+    bool select(uint8_t session);
+    bool connected();
+    bool accepted();
     int available() override;
     int read() override;
     int peek() override;
     void flush() override;
     size_t write(uint8_t b) override;
-    //size_t write(const uint8_t *buffer, size_t size) override;  // Override for writing buffers
+    size_t write(const uint8_t *buffer, size_t size) override;  // Override for writing buffers
     using Print::write;  // Bring in other overloads of write from Print
 
 private:
+    // One client connection, with its own buffers
+    struct Session {
+        EthernetClient client;
+        bool isNew;                                 // Client accepted, not yet reported by accepted()
+        uint8_t rxBuffer[PROLOGIX_RX_BUFFER_SIZE];  // Data received in one block read, not yet consumed
+        size_t rxPos;                               // Next byte to consume from rxBuffer
+        size_t rxLen;                               // Number of bytes in rxBuffer
+        uint8_t txBuffer[PROLOGIX_TX_BUFFER_SIZE];  // Data waiting to be sent, in one socket write
+        size_t txLen;                               // Number of bytes in txBuffer
+        unsigned long txTime;                       // Time the last byte was added to txBuffer
+        unsigned long lastActivityTime;             // Track the last activity time
+    };
     byte* mac;
     IPAddress ip;
     uint16_t port;
     void checkClient();
+    void closeClient(Session &s);
     EthernetServer *server;
-    EthernetClient client;
-    String buffer;
-    unsigned long lastActivityTime;  // Track the last activity time
+    Session sessions[PROLOGIX_SESSIONS];
+    Session *current;  // The session the stream reads from and writes to, see select()
+    bool fillBuffer();
+    void sendBuffer(Session &s);
     const unsigned long timeout;  // Timeout period in milliseconds
 
 
@@ -27,12 +27,37 @@
 // for the Prologix server: 
 #define AR_ETHERNET_PORT
 #define PROLOGIX_PORT 1234
+// Number of clients the Prologix server serves at the same time, each with its own address and settings.
+// Each client costs a socket and about 350 bytes of RAM.
+#define PROLOGIX_SESSIONS 2
+// Maximum number of received lines the Prologix server runs in one loop, before it does other work or serves another client
+#define PROLOGIX_BATCH_LINES 16
+// Size of the transmit buffer of the Prologix server. The buffer is sent when it is full, at the end of a line,
+// at the end of a GPIB transfer, or when nothing has been added for PROLOGIX_TX_IDLE ms.
+#define PROLOGIX_TX_BUFFER_SIZE 128
+#define PROLOGIX_TX_IDLE 5
+// Size of the receive buffer of the Prologix server. Received data is fetched from the network chip in blocks of this size.
+#define PROLOGIX_RX_BUFFER_SIZE 64
 
 // For the VXI server:
 #define VXI11_PORT 9010
+// Number of ports, from VXI11_PORT on, over which the port mapper spreads new VXI connections (round robin).
+// A client that reconnects quickly then does not have to wait for its previous connection to close.
+// Each port costs a socket, so 1 (no rotation) is the default.
+#define VXI11_PORTS 1
+// Port of the VXI-11 abort channel (DEVICE_ASYNC). It costs a socket. Comment out to disable the abort channel.
+#define VXI11_ABORT_PORT 9009
 // Maximum number of clients for the VXI server:
 // Max MAX_SOCK_NUM sockets on the device. You will likely not even be able to reach that number, because of other sockets open or busy closing
 #define MAX_VXI_CLIENTS MAX_SOCK_NUM
+// Maximum number of VXI links (one per instrument per client). A client can create several links over one connection.
+#define MAX_VXI_LINKS 16
+// Time in ms to wait for the connection of the VXI-11 interrupt channel (CREATE_INTR_CHAN) to the client
+#define VXI_INTR_CONNECT_TIMEOUT 1000
+// Time in ms a VXI client gets to complete a request that has partially arrived, before the connection is closed
+#define VXI_RX_TIMEOUT 2000
+// Time in ms a VXI client gets to make room for a response (i.e. to read the previous data), before the connection is closed
+#define VXI_TX_TIMEOUT 2000
 // set LOG_VXI_DETAILS to 0 or 1, depending on whether you want to see VXI details on the debugPort
 // setting to 1 messes up the serial menu a bit
 #define LOG_VXI_DETAILS 0
@@ -58,6 +58,7 @@
 #include "user_interface.h"
 #ifdef INTERFACE_VXI11
 #include "rpc_bind_server.h"
+#include "rpc_enums.h"
 #include "vxi_server.h"
 #endif
 // The following file is needed for the gpib setup, even if you do not use prologix. 
@@ -78,38 +79,6 @@ extern GPIBbus gpibBus;
 
 // #define DUMMY_DEVICE
 
-/**
- * @brief a helper class to capture data printed by receiveData (using Stream.write(uint8_t ch)) to an external buffer
- */
-class bufStream : public Stream {
-   public:
-    bufStream(char *buf, size_t size) : buffer(buf), bufferSize(size) {}
-
-    size_t write(uint8_t ch) override {
-        // debugPort.print((char)ch);
-        if (buffer_pos < bufferSize) {
-            buffer[buffer_pos++] = ch;
-            return 1;
-        }
-        return 0;
-    }
-
-    int available() { return 0; }  // dummy
-    int read() { return 0; }       // dummy
-    int peek() { return 0; }       // dummy
-
-    size_t len(void) { return buffer_pos; }
-
-    void flush() {
-        buffer_pos = 0;  // clear the buffer
-    }
-
-   private:
-    char *buffer;
-    size_t bufferSize;
-    size_t buffer_pos = 0;
-};
-
 /**
  * @brief SCPI handler interface
  *
@@ -119,27 +88,30 @@ class SCPI_handler : public SCPI_handler_interface {
    public:
     SCPI_handler() {}
 
-    void write(int address, const char *data, size_t len) override {
+    bool write(int address, const char *data, size_t len, bool end) override {
 #ifdef DUMMY_DEVICE
         debugPort.print(F("SCPI write: "));
         printBuf(data, len);
+        return true;
 #else
         if (address == 0) {
             // maybe we need to address a device directly on the bus
             address = gpibBus.cfg.caddr;
         }
-        if (address == 0) return; // if controller: no writing to the bus
+        if (address == 0) return true; // if controller: no writing to the bus
 
         // Send data to the GPIB bus
         gpibBus.cfg.paddr = address;
         gpibBus.cfg.saddr = 0xFF;  // secondary address is not used
-        if (!gpibBus.haveAddressedDevice()) gpibBus.addressDevice(address, 0xFF, TOLISTEN);
-        gpibBus.sendData(data, len);
-        gpibBus.unAddressDevice();
+        // The device stays addressed after the write. This is how a chunked write is continued,
+        // and it saves the addressing commands when the next transfer is with the same device.
+        if (gpibBus.addressDevice(address, 0xFF, TOLISTEN)) return false;
+        return !gpibBus.sendData(data, len, end);  // terminator and EOI only after the last chunk
 #endif
     }
 
-    bool read(int address, char *data, size_t *len, size_t max_len) override {
+    bool read(int address, char *data, size_t *len, size_t max_len, uint32_t *reason, int term_char) override {
+        *reason = rpc::END;
 #ifdef DUMMY_DEVICE
         // Simulate a device response
         memset(data, 0, max_len);
@@ -153,31 +125,121 @@ class SCPI_handler : public SCPI_handler_interface {
         // dummy reply if I am addressed
         if (address == 0) {
             strncpy(data, DEVICE_NAME, max_len);
-            *len = strlen(data);
+            *len = strnlen(data, max_len);
             return true;  // no address
         }
-        bufStream buf = bufStream(data, max_len);  ///< Buffer stream for incoming data
-
         bool readWithEoi = true;
-        bool detectEndByte = false;
-        uint8_t endByte = 0;
+        bool detectEndByte = (term_char >= 0);  // the client's termination character, in addition to EOI
+        uint8_t endByte = detectEndByte ? (uint8_t)term_char : 0;
+
+        enum receiveEndReasons rx_reason;
 
         gpibBus.cfg.paddr = address;
         gpibBus.cfg.saddr = 0xFF;  // secondary address is not used
-        gpibBus.addressDevice(address, 0xFF, TOTALK);     // tel device 'paddr' to talk. If you do this and the device has nothing to say, you might get an error.
-        gpibBus.receiveData(buf, readWithEoi, detectEndByte, endByte);  // get the data from the bus and send out
-        gpibBus.unAddressDevice();
-        *len = buf.len();
+        // The device stays addressed after the read. When it has more to say, the next read continues where this one stopped.
+        *len = 0;
+        if (gpibBus.addressDevice(address, 0xFF, TOTALK)) return false;     // tel device 'paddr' to talk. If you do this and the device has nothing to say, you might get an error.
+        if (gpibBus.receiveData((uint8_t *)data, max_len, len, readWithEoi, detectEndByte, endByte, &rx_reason)) {  // get the data from the bus directly into the response
+            return false;  // the device stopped talking before the end of its response
+        }
+        if (rx_reason == RX_COUNT) {
+            *reason = rpc::REQCNT;
+        } else if (rx_reason == RX_ENDBYTE) {
+            *reason = rpc::CHR;
+        }
         return true;
 #endif
     }
 
+    void set_timeout(uint32_t io_timeout) override {
+#ifndef DUMMY_DEVICE
+        // 0 means: do not wait. The bus has no such thing, make it as short as possible.
+        gpibBus.setTimeout(io_timeout ? io_timeout : 1);
+#endif
+    }
+
     bool claim_control() override {
         // not needed for the GPIB bus, is done differently
         return true;
     }
     void release_control() override {
-        // not needed for the GPIB bus, is done differently
+        // a link is going away, do not leave a device addressed
+#ifndef DUMMY_DEVICE
+        if (gpibBus.haveAddressedDevice() != TONONE) gpibBus.unAddressDevice();
+#endif
+    }
+    void abort() override {
+        // only signal it, the transfer in progress stops at its next handshake step
+#ifndef DUMMY_DEVICE
+        gpibBus.signalBreak();
+#endif
+    }
+    bool readstb(int address, uint8_t *stb) override {
+        *stb = 0;
+#ifndef DUMMY_DEVICE
+        address = bus_address(address);
+        if (address == 0) return true;  // the controller itself has nothing to report
+        if (gpibBus.serialPoll(address, 0xFF, stb)) return false;
+#endif
+        return true;
+    }
+    bool trigger(int address) override {
+#ifndef DUMMY_DEVICE
+        address = bus_address(address);
+        if (address == 0) return true;
+        if (gpibBus.sendGET(address)) return false;
+#endif
+        return true;
+    }
+    bool clear(int address) override {
+#ifndef DUMMY_DEVICE
+        address = bus_address(address);
+        if (address == 0) return true;
+        if (gpibBus.sendSDC()) return false;
+#endif
+        return true;
+    }
+    bool remote(int address) override {
+#ifndef DUMMY_DEVICE
+        address = bus_address(address);
+        if (address == 0) return true;
+        // REN is always asserted in controller mode, so addressing the device to listen makes it remote
+        if (gpibBus.addressDevice(address, 0xFF, TOLISTEN)) return false;
+#endif
+        return true;
+    }
+    bool local(int address) override {
+#ifndef DUMMY_DEVICE
+        address = bus_address(address);
+        if (address == 0) return true;
+        if (gpibBus.sendGTL()) return false;
+#endif
+        return true;
+    }
+    bool srq() override {
+#ifdef DUMMY_DEVICE
+        return false;
+#else
+        return gpibBus.isAsserted(SRQ_PIN);
+#endif
+    }
+
+   private:
+    /**
+     * @brief Get the GPIB address to use for a link address, and make it the current device.
+     *
+     * Address 0 is the controller, unless a default instrument has been configured.
+     * @return the GPIB address, 0 for the controller itself
+     */
+    int bus_address(int address) {
+        if (address == 0) {
+            address = gpibBus.cfg.caddr;
+        }
+        if (address != 0) {
+            gpibBus.cfg.paddr = address;
+            gpibBus.cfg.saddr = 0xFF;  // secondary address is not used
+        }
+        return address;
     }
 
 };
@@ -190,6 +252,15 @@ static SCPI_handler scpi_handler;                    ///< The bridge from the vx
 static VXI_Server vxi_server(scpi_handler);          ///< The vxi server
 static RPC_Bind_Server rpc_bind_server(vxi_server);  ///< The RPC_Bind_Server for the vxi server
 
+#ifdef VXI11_ABORT_PORT
+/**
+ * @brief Called by the GPIB bus while it waits, so that an abort request can stop a long transfer.
+ */
+static void vxi_idle() {
+    vxi_server.poll_abort();
+}
+#endif
+
 #pragma endregion
 
 #endif  // INTERFACE_VXI11
@@ -258,6 +329,10 @@ void setup() {
 #ifdef INTERFACE_VXI11
     debugPort.println(F("Starting VXI-11 TCP server..."));
     vxi_server.begin(VXI11_PORT, LOG_VXI_DETAILS);
+#ifdef VXI11_ABORT_PORT
+    vxi_server.begin_abort(VXI11_ABORT_PORT);
+    gpibBus.setIdleCallback(vxi_idle);
+#endif
 
     debugPort.println(F("Starting VXI-11 port mappers on TCP and UDP..."));
     rpc_bind_server.begin(LOG_VXI_DETAILS);
@@ -22,6 +22,7 @@
 //      * individualise the setup of the gpib bus (see `setup_gpibBusConfig`)
 //      * added loads of forward declarations, to be compatible with platformio and other compilers
 //      * added a small helper function `prologix_nr_connections()`
+//      * serves several clients, each with its own parse buffer and settings (see `nextSession`)
 //
 // All changed sections are marked with ">>> Modified" comments.
 
@@ -142,7 +143,44 @@ const char * const macros[] PROGMEM = {
  */
 // Serial input parsing buffer
 static const uint8_t PBSIZE = 128;
-char pBuf[PBSIZE];
+
+// >>> Modified: each client has its own parse buffer and state, see selectSession()
+// Settings of the gpibBus.cfg that belong to a client
+struct sessionSettings {
+  uint8_t paddr;
+  uint8_t saddr;
+  uint8_t eos;
+  uint8_t eor;
+  uint8_t amode;
+  bool eoi;
+  bool eot_en;
+  char eot_ch;
+  uint16_t rtmo;
+};
+
+// State of a client that is not being served
+struct prologixSession {
+  char pBuf[PBSIZE];
+  uint8_t pbPtr;
+  uint8_t lnRdy;
+  uint8_t endByte;
+  bool isVerb;
+  bool autoRead;
+  bool readWithEoi;
+  bool readWithEndByte;
+  bool isQuery;
+  bool isEsc;
+  bool isPlusEscaped;
+  bool dataBufferFull;
+  bool sendIdn;
+  sessionSettings settings;
+};
+
+prologixSession prologixSessions[PROLOGIX_SESSIONS];
+uint8_t currentSession = 0;
+uint8_t bgReadSession = 0;  // the client that started the read in the background
+
+char *pBuf = prologixSessions[0].pBuf;
 uint8_t pbPtr = 0;
 
 /***** ^^^^^^^^^^^^^^^^^^^ *****/
@@ -269,6 +307,9 @@ uint8_t runMacro = 0;
 // Send response to *idn?
 bool sendIdn = false;
 
+// >>> Modified: settings for a new client (as at startup, or as saved last)
+sessionSettings defaultSettings;
+
 /***** ^^^^^^^^^^^^^^^^^^^^^^^^ *****/
 /***** COMMON VARIABLES SECTION *****/
 /************************************/
@@ -362,8 +403,16 @@ void send_h(char* params);
 void unlisten_h();
 void untalk_h();
 void execCmd(char *buffr, uint8_t dsize);
-void sendToInstrument(char *buffr, uint8_t dsize);
+void sendToInstrument(char *buffr, size_t dsize);
 void getCmd(char *buffr);
+#ifdef DEBUG_CMD_PARSER
+void checkCmdTable();
+#endif
+void getSettings(sessionSettings &settings);
+void selectSession(uint8_t session);
+void nextSession();
+void processLine();
+void stopBackgroundRead();
 
 /***** ^^^^^^^^^^^^^^^^^^^ *****/
 /***** Function Prototypes *****/
@@ -484,6 +533,14 @@ void setup_prologix(void) {
   // Initialise parse buffer
   flushPbuf();
 
+#ifdef DEBUG_CMD_PARSER
+  // >>> Modified: getCmd() does a binary search, report a table that is not sorted
+  checkCmdTable();
+#endif
+
+  // >>> Modified: new clients start with the current settings
+  getSettings(defaultSettings);
+
   // Initialise dataport, serial or ethernet as defined
   startDataPort();
 }
@@ -495,12 +552,16 @@ void setup_prologix(void) {
 /**
  * @brief run the main loop for the prologix server
  * 
- * @return int the number of active clients (can only be 0 or 1)
+ * @return int the number of active clients (up to PROLOGIX_SESSIONS)
  */
 int loop_prologix(void) {
   int nrclients = maintainDataPort();
 
-  bool errFlg = false; 
+  // >>> Modified: serve the clients in turn, a batch of lines at a time.
+  // A line that does not fit the parse buffer is sent to the bus completely before another client gets its turn.
+#ifdef AR_ETHERNET_PORT
+  if (!dataBufferFull || !dataPort.connected()) nextSession();
+#endif
 
 /*** Macros ***/
 /*
@@ -514,6 +575,27 @@ int loop_prologix(void) {
   }
 #endif
 
+  // >>> Modified: run all lines that have already been received, instead of one line per loop.
+  // The lines are run in order, with the usual bus checks (SRQ, ATN in device mode) between them.
+  // PROLOGIX_BATCH_LINES limits the batch, so that a client that keeps sending does not lock out the others.
+  uint8_t lines = 0;
+  do {
+    processLine();
+  } while (lnRdy > 0 && ++lines < PROLOGIX_BATCH_LINES);
+
+  delayMicroseconds(5);
+
+  // >> Modified: return the number of active clients
+  return nrclients;
+}
+/***** END MAIN LOOP *****/
+
+
+/***** Run a received line *****/
+// >>> Modified: moved out of loop_prologix(), so that it can run several lines per loop
+void processLine() {
+
+  bool errFlg = false; 
 
 /*** Process the buffer ***/
 /* Each received char is passed through parser until an un-escaped 
@@ -533,6 +615,12 @@ if (lnRdy>0){
 }
 */
 
+  // >>> Modified: a read in the background ends when the bus is needed for something else,
+  //    also when another client wants to read continuously
+  if (lnRdy > 0 || (isSrqa && gpibBus.isAsserted(SRQ_PIN)) || (autoRead && bgReadSession != currentSession)) {
+    stopBackgroundRead();
+  }
+
   // lnRdy=1: received a command so execute it...
   if (lnRdy == 1) {
     if (autoRead) {
@@ -546,15 +634,17 @@ if (lnRdy>0){
   // Controller mode:
   if (gpibBus.isController()) {
     // lnRdy=2: received data - send it to the instrument...
+    // >>> Modified: no auto-read while the rest of the data has still to be sent
     if (lnRdy == 2) {
+      bool moreData = dataBufferFull;
 
       sendToInstrument(pBuf, pbPtr);
 
       // Auto-read data from GPIB bus following any command
-      if (gpibBus.cfg.amode == 1) {
+      // >>> Modified: the device stays addressed (addressDevice only sends what changed)
+      if (gpibBus.cfg.amode == 1 && !moreData) {
         gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOTALK);
         errFlg = gpibBus.receiveData(dataPort, gpibBus.cfg.eoi, false, 0);
-        gpibBus.unAddressDevice();
       }
 
       // Auto-receive data from GPIB bus following a query command
@@ -562,7 +652,6 @@ if (lnRdy>0){
         gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOTALK);
         errFlg = gpibBus.receiveData(dataPort, gpibBus.cfg.eoi, false, 0);
         isQuery = false;
-        gpibBus.unAddressDevice();
       }
 
     }
@@ -571,8 +660,23 @@ if (lnRdy>0){
     if ((gpibBus.cfg.amode==3) && autoRead) {
       // Nothing is waiting on the serial input so read data from GPIB
       if (lnRdy==0) {
-        if (gpibBus.haveAddressedDevice() == TONONE) gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOTALK);
+#ifdef GPIB_INTERRUPT_RECEIVE
+        // >>> Modified: read in the background (the DAV interrupt does the handshake), so that the
+        //    loop keeps serving the network while the instrument sends. Not when reading up to an end byte.
+        if (!readWithEndByte) {
+          if (!gpibBus.isBackgroundReceiving()) {
+            gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOTALK);
+            errFlg = gpibBus.startBackgroundReceive(readWithEoi);
+            bgReadSession = currentSession;
+          }
+          gpibBus.receiveBackground(dataPort);
+        } else {
+#endif
+        gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOTALK);
         errFlg = gpibBus.receiveData(dataPort, readWithEoi, readWithEndByte, endByte);
+#ifdef GPIB_INTERRUPT_RECEIVE
+        }
+#endif
       }
     }
 
@@ -624,16 +728,154 @@ if (lnRdy>0){
 
   // If charaters waiting in the serial input buffer then call handler
   if (dataPort.available()) lnRdy = serialIn_h();
+}
 
-  delayMicroseconds(5);
 
-  // >> Modified: return the number of active clients
-  return nrclients;
+/***** End a read in the background *****/
+// >>> Modified: added, passes on what has been received and frees the bus
+void stopBackgroundRead() {
+#ifdef GPIB_INTERRUPT_RECEIVE
+  if (gpibBus.isBackgroundReceiving()) {
+#ifdef AR_ETHERNET_PORT
+    // the data goes to the client that started the read
+    uint8_t session = currentSession;
+    if (session != bgReadSession) {
+      dataPort.select(bgReadSession);
+      selectSession(bgReadSession);
+    }
+#endif
+    gpibBus.stopBackgroundReceive(dataPort);
+#ifdef AR_ETHERNET_PORT
+    if (session != currentSession) {
+      dataPort.select(session);
+      selectSession(session);
+    }
+#endif
+  }
+#endif
 }
-/***** END MAIN LOOP *****/
 
 
 
+/***** Client sessions *****/
+// >>> Modified: added this section
+/*
+ * Each client of the ethernet data port has its own parse buffer, parser
+ * state and addressing settings (++addr, ++eos, ++eoi, ++eor, ++eot_enable,
+ * ++eot_char, ++auto, ++read_tmo_ms), so that clients do not change each
+ * other's address or mode. The client being served uses the usual
+ * variables and gpibBus.cfg; its state is swapped with the saved state of
+ * the next client when that gets its turn. Controller/device mode, ++lon,
+ * ++ton and ++srqauto belong to the bus and are shared, and so is ++addr
+ * in device mode, where it is the address of the gateway.
+ */
+
+/***** Copy the client settings from gpibBus.cfg *****/
+void getSettings(sessionSettings &settings) {
+  settings.paddr = gpibBus.cfg.paddr;
+  settings.saddr = gpibBus.cfg.saddr;
+  settings.eos = gpibBus.cfg.eos;
+  settings.eor = gpibBus.cfg.eor;
+  settings.amode = gpibBus.cfg.amode;
+  settings.eoi = gpibBus.cfg.eoi;
+  settings.eot_en = gpibBus.cfg.eot_en;
+  settings.eot_ch = gpibBus.cfg.eot_ch;
+  settings.rtmo = gpibBus.cfg.rtmo;
+}
+
+
+/***** Copy the client settings to gpibBus.cfg *****/
+// The address is only the client's in controller mode, in device mode it is the address of the gateway
+void putSettings(const sessionSettings &settings) {
+  if (gpibBus.cfg.cmode == 2) {
+    gpibBus.cfg.paddr = settings.paddr;
+    gpibBus.cfg.saddr = settings.saddr;
+  }
+  gpibBus.cfg.eos = settings.eos;
+  gpibBus.cfg.eor = settings.eor;
+  gpibBus.cfg.amode = settings.amode;
+  gpibBus.cfg.eoi = settings.eoi;
+  gpibBus.cfg.eot_en = settings.eot_en;
+  gpibBus.cfg.eot_ch = settings.eot_ch;
+  gpibBus.cfg.rtmo = settings.rtmo;
+}
+
+
+/***** Swap the client being served *****/
+void selectSession(uint8_t session) {
+  prologixSession &s = prologixSessions[currentSession];
+  // save the current client (its parse buffer is already in place)
+  s.pbPtr = pbPtr;
+  s.lnRdy = lnRdy;
+  s.endByte = endByte;
+  s.isVerb = isVerb;
+  s.autoRead = autoRead;
+  s.readWithEoi = readWithEoi;
+  s.readWithEndByte = readWithEndByte;
+  s.isQuery = isQuery;
+  s.isEsc = isEsc;
+  s.isPlusEscaped = isPlusEscaped;
+  s.dataBufferFull = dataBufferFull;
+  s.sendIdn = sendIdn;
+  getSettings(s.settings);
+
+  // and restore the next one
+  currentSession = session;
+  prologixSession &n = prologixSessions[session];
+  pBuf = n.pBuf;
+  pbPtr = n.pbPtr;
+  lnRdy = n.lnRdy;
+  endByte = n.endByte;
+  isVerb = n.isVerb;
+  autoRead = n.autoRead;
+  readWithEoi = n.readWithEoi;
+  readWithEndByte = n.readWithEndByte;
+  isQuery = n.isQuery;
+  isEsc = n.isEsc;
+  isPlusEscaped = n.isPlusEscaped;
+  dataBufferFull = n.dataBufferFull;
+  sendIdn = n.sendIdn;
+  putSettings(n.settings);
+}
+
+
+/***** Give the turn to the next connected client *****/
+// Only the ethernet data port has several clients
+#ifdef AR_ETHERNET_PORT
+void nextSession() {
+  uint8_t session = currentSession;
+  // when nobody is connected, this ends on the current client
+  for (uint8_t i = 0; i < PROLOGIX_SESSIONS; i++) {
+    session = (session + 1) % PROLOGIX_SESSIONS;
+    if (dataPort.select(session)) break;
+  }
+  // a read in the background goes on, it only ends when the other client needs the bus (see processLine())
+  if (session != currentSession) selectSession(session);
+
+  // A new client starts with a clean state and the default settings
+  if (dataPort.accepted()) {
+#ifdef GPIB_INTERRUPT_RECEIVE
+    // nobody left for the data of a read in the background of the previous client
+    if (currentSession == bgReadSession) gpibBus.stopBackgroundReceive();
+#endif
+    flushPbuf();
+    lnRdy = 0;
+    endByte = 0;
+    isVerb = false;
+    autoRead = false;
+    readWithEoi = false;
+    readWithEndByte = false;
+    isQuery = false;
+    isEsc = false;
+    isPlusEscaped = false;
+    dataBufferFull = false;
+    sendIdn = false;
+    putSettings(defaultSettings);
+  }
+}
+#endif
+
+
 /***** Initialise device mode *****/
 void initDevice() {
   gpibBus.stop();
@@ -860,9 +1102,12 @@ void flushPbuf() {
 
 
 /***** Comand function record *****/
+// >>> Modified: the token is part of the record, so that the whole table can be in PROGMEM
+static const uint8_t CMD_TOKEN_SIZE = 12;  // Longest token ("read_tmo_ms") + 1
+
 struct cmdRec { 
-  const char* token; 
-  int opmode;
+  char token[CMD_TOKEN_SIZE]; 
+  uint8_t opmode;
   void (*handler)(char *);
 };
 
@@ -876,7 +1121,9 @@ struct cmdRec {
  * Format: token, mode, function_ptr
  * Mode: 1=device; 2=controller; 3=both; 
  */
-static cmdRec cmdHidx [] = { 
+// >>> Modified: in PROGMEM, and sorted by token (getCmd does a binary search).
+//    Keep it sorted when adding a command, in the order of strcasecmp ('_' comes before letters).
+static const cmdRec cmdHidx [] PROGMEM = { 
  
   { "addr",        3, addr_h      }, 
   { "allspoll",    2, (void(*)(char*)) aspoll_h  },
@@ -892,9 +1139,9 @@ static cmdRec cmdHidx [] = {
   { "flags",       2, hflags_h    },
   { "fndl",        2, fndl_h      },
   { "help",        3, help_h      },
-  { "ifc",         2, (void(*)(char*)) ifc_h     },
   { "id",          3, id_h        },
   { "idn",         3, idn_h       },
+  { "ifc",         2, (void(*)(char*)) ifc_h     },
   { "llo",         2, llo_h       },
   { "loc",         2, loc_h       },
   { "lon",         1, lon_h       },
@@ -907,7 +1154,6 @@ static cmdRec cmdHidx [] = {
   { "ren",         2, ren_h       },
   { "repeat",      2, repeat_h    },
   { "rst",         3, (void(*)(char*)) rst_h     },
-  { "trg",         2, trg_h       },
   { "savecfg",     3, (void(*)(char*)) save_h    },
 //  { "secread",     2, secread_h   },
   { "send",        2, send_h      },
@@ -918,6 +1164,7 @@ static cmdRec cmdHidx [] = {
   { "status",      1, stat_h      },
   { "tct",         2, tct_h       },
   { "ton",         1, ton_h       },
+  { "trg",         2, trg_h       },
   { "unl",         2, (void(*)(char*)) unlisten_h  },
   { "unt",         2, (void(*)(char*)) untalk_h    },
   { "ver",         3, ver_h       },
@@ -937,7 +1184,10 @@ void showPrompt() {
 /* Processes the parse buffer when full or CR/LF detected
  * and sends data to the instrument
  */
-void sendToInstrument(char *buffr, uint8_t dsize) {
+// >>> Modified: size_t dsize, and data that does not fit the parse buffer is sent as one
+//    continuous transfer: no terminator or EOI until the last chunk.
+//    The device stays addressed afterwards (addressDevice only sends what changed)
+void sendToInstrument(char *buffr, size_t dsize) {
 
 #ifdef DEBUG_SEND_TO_INSTR
   if (buffr[dsize] != LF) DB_RAW_PRINTLN();
@@ -945,20 +1195,15 @@ void sendToInstrument(char *buffr, uint8_t dsize) {
 #endif
 
   // Is this an instrument query command (string ending with ?)
-  if (buffr[dsize-1] == '?') isQuery = true;
+  if (!dataBufferFull && buffr[dsize-1] == '?') isQuery = true;
 
   if (gpibBus.isController()) {
-    // Has controller already addressed the device? - if not then address it
-    if (gpibBus.haveAddressedDevice() != TOLISTEN) gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOLISTEN);
+    // Address the device, unless the controller has already done so
+    gpibBus.addressDevice(gpibBus.cfg.paddr, gpibBus.cfg.saddr, TOLISTEN);
   }
 
-  // Send string to instrument
-  gpibBus.sendData(buffr, dsize);
-
-  // If controller then unaddress devicesendTo
-  if (gpibBus.isController() &&  dataBufferFull == false) {
-    gpibBus.unAddressDevice();
-  }
+  // Send string to instrument, more data follows when the buffer was full
+  gpibBus.sendData(buffr, dsize, !dataBufferFull);
 
   // Clear buffer full flag
   if (dataBufferFull) dataBufferFull = false;
@@ -1038,20 +1283,37 @@ void getCmd(char *buffr) {
   DB_PRINT(F("process token: "), token);
 #endif
 
+  // Blank line with only spaces or tabs
+  if (token == NULL) return;
+
   // Check whether it is a valid command token
-  i = 0;
-  do {
-    if (strcasecmp(cmdHidx[i].token, token) == 0) break;
-    i++;
-  } while (i < casize);
+  // >>> Modified: binary search in the sorted table
+  int lo = 0;
+  int hi = casize - 1;
+  i = casize;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    int cmp = strcasecmp_P(token, cmdHidx[mid].token);
+    if (cmp == 0) {
+      i = mid;
+      break;
+    }
+    if (cmp < 0) {
+      hi = mid - 1;
+    } else {
+      lo = mid + 1;
+    }
+  }
 
   if (i < casize) {
     // We have found a valid command and handler
+    uint8_t opmode = pgm_read_byte(&cmdHidx[i].opmode);
+    void (*handler)(char *) = (void (*)(char *))pgm_read_word(&cmdHidx[i].handler);
 #ifdef DEBUG_CMD_PARSER
-    DB_PRINT(F("found handler for: "), cmdHidx[i].token);
+    DB_PRINT(F("found handler for: "), token);
 #endif
     // If command is relevant to mode then execute it
-    if (cmdHidx[i].opmode & gpibBus.cfg.cmode) {
+    if (opmode & gpibBus.cfg.cmode) {
       // If its a command with parameters
       // Copy command parameters to params and call handler with parameters
       params = token + strlen(token) + 1;
@@ -1062,13 +1324,13 @@ void getCmd(char *buffr) {
         DB_PRINT(F("calling handler with parameters: "), params);
 #endif
         // Call handler with parameters specified
-        cmdHidx[i].handler(params);
+        handler(params);
       }else{
 #ifdef DEBUG_CMD_PARSER
         DB_PRINT(F("calling handler without parameters..."),"");
 #endif
         // Call handler without parameters
-        cmdHidx[i].handler(NULL);
+        handler(NULL);
       }
 #ifdef DEBUG_CMD_PARSER
       DB_PRINT(F("handler done."),"");
@@ -1085,6 +1347,24 @@ void getCmd(char *buffr) {
 }
 
 
+#ifdef DEBUG_CMD_PARSER
+/***** Check that the command table is sorted *****/
+// >>> Modified: added, see also SW/test_tools/benchCmdLookup.cpp
+void checkCmdTable() {
+  char prev[CMD_TOKEN_SIZE];
+  int casize = sizeof(cmdHidx) / sizeof(cmdHidx[0]);
+
+  strncpy_P(prev, cmdHidx[0].token, CMD_TOKEN_SIZE);
+  for (int i = 1; i < casize; i++) {
+    if (strcasecmp_P(prev, cmdHidx[i].token) >= 0) {
+      DB_PRINT(F("command table not sorted after: "), prev);
+    }
+    strncpy_P(prev, cmdHidx[i].token, CMD_TOKEN_SIZE);
+  }
+}
+#endif
+
+
 /***** Prints charaters as heatoix bytes *****/
 /*
 void printHex(char *buffr, int dsize) {
@@ -1482,7 +1762,8 @@ void read_h(char *params) {
 //DB_PRINT(F("readWithEndByte: "), readWithEndByte);
 
   // Address device to talk
-  if (gpibBus.haveAddressedDevice() != TOTALK) gpibBus.addressDevice(pri, sec, TOTALK);
+  // >>> Modified: always call addressDevice (it only sends what changed), and no unaddress after the read
+  gpibBus.addressDevice(pri, sec, TOTALK);
 
   // Read data
   if (gpibBus.cfg.amode == 3) {
@@ -1491,7 +1772,6 @@ void read_h(char *params) {
   } else {
     // If auto mode is disabled we do a single read
     gpibBus.receiveData(dataPort, readWithEoi, readWithEndByte, endByte);
-    gpibBus.unAddressDevice();
     if ( !autoRead && (gpibBus.cfg.hflags & 0x02) ) dataPort.println(F("Read^OK"));
   }
 }
@@ -1718,6 +1998,39 @@ void spoll_h(char *params) {
 
   }
 
+  // >>> Modified: poll all in one SPE/SPD sequence, the known devices first
+  if (all) {
+    uint8_t stb[31];
+    uint32_t rqs = 0;
+    uint32_t candidates = 0x3FFFFFFFUL & ~(1UL << gpibBus.cfg.caddr);  // addresses 0 to 29, but not our own
+    uint32_t known = gpibBus.getKnownDevices() & candidates;
+
+    // The others only when none of the known devices requested service, and SRQ says that one did
+    if (known && gpibBus.pollDevices(known, stb, &rqs, true)) {
+#ifdef DEBUG_SPOLL
+      DB_PRINT(F("failed to poll the known devices"),"");
+#endif
+      return;
+    }
+    if (!rqs && gpibBus.isAsserted(SRQ_PIN) && gpibBus.pollDevices(candidates & ~known, stb, &rqs, true)) {
+#ifdef DEBUG_SPOLL
+      DB_PRINT(F("failed to poll the devices"),"");
+#endif
+      return;
+    }
+
+    // Specially formatted response: SRQ:addr,status, for the first device with RQS set
+    for (uint8_t i = 0; i < 30; i++) {
+      if (rqs & (1UL << i)) {
+        dataPort.print(F("SRQ:")); dataPort.print(i); dataPort.print(F(",")); dataPort.println(stb[i], DEC);
+        break;
+      }
+    }
+    dataPort.println();
+    if (isVerb) dataPort.println(F("Serial poll completed."));
+    return;
+  }
+
   // Send Unlisten [UNL] to all devices
   if ( gpibBus.sendCmd(GC_UNL) )  {
 #ifdef DEBUG_SPOLL
@@ -1866,6 +2179,7 @@ void stat_h(char *params) {
 void save_h() {
 #ifdef E2END
   epWriteData(gpibBus.cfg.db, GPIB_CFG_SIZE);
+  getSettings(defaultSettings);  // >>> Modified: new clients start with these settings
   if (isVerb) dataPort.println(F("Settings saved."));
 #else
   dataPort.println(F("EEPROM not supported."));
@@ -2507,7 +2821,6 @@ void fndl_h(char *params) {
   char *param;
   uint16_t addrval = 0;
   uint8_t addrList[15] = {0};
-  uint16_t tmo = gpibBus.cfg.rtmo;
   uint8_t acnt = 0;
 //  uint8_t xmit = true;
   uint8_t i = 0;
@@ -2515,16 +2828,13 @@ void fndl_h(char *params) {
   uint8_t pri = 0xFF;
   unsigned long range[2] = {0,0};
   bool list = false;
-  bool secfound = false;
+  bool found = false;
 
   // Initialise arrays
   for (int i = 0; i < 15; i++) {
     addrList[i] = 0;
   }
 
-  // Set minimal timeout
-  gpibBus.cfg.rtmo = 35;
-
   // Read parameters
   if (params == NULL) {
     // No parameters given - no action to be taken
@@ -2583,6 +2893,10 @@ void fndl_h(char *params) {
 
   }
 
+  // Set minimal timeout (for a bus without devices)
+  // >>> Modified: via setTimeout(), so that the config is not touched
+  gpibBus.setTimeout(35);
+
   // Poll the range of GPIB adresses
   while (i<j) {
 
@@ -2602,73 +2916,48 @@ void fndl_h(char *params) {
 //Serial.print("PRI: ");
 //Serial.println(pri);
 
-    // Send UNL + UNT + LAD (addressDevice function adds 0x20 to pri)
-    if (gpibBus.addressDevice(pri, 0xFF, TOLISTEN) == ERR) {
+    // >>> Modified: address as listener and sample NDAC within microseconds (see GPIBbus::findListener()),
+    //    instead of waiting 1.6 ms per address
+    if (gpibBus.findListener(pri, 0xFF, 0xFF, &found) == ERR) {
       errorMsg(3);
       break;
     }
 
-    gpibBus.clearSignal(ATN_BIT);
-    delayMicroseconds(1600);
-
-    if (gpibBus.isAsserted(NDAC_PIN)) {
+    if (found) {
  
-      if (acnt>0) Serial.print(',');
+      if (acnt>0) dataPort.print(',');
       dataPort.print(pri);
       acnt++;
 
     }else{
 
-      // Send all secondary addresses
-      gpibBus.assertSignal(ATN_BIT);
-      for (uint8_t sec=0x60; sec<0x7F; sec++){
-        gpibBus.writeByte(sec, false);
+      // Any listener at one of the secondary addresses?
+      if (gpibBus.findListener(pri, 0x60, 0x7E, &found) == ERR) {
+        errorMsg(3);
+        break;
       }
-      
-      gpibBus.clearSignal(ATN_BIT);
-      delayMicroseconds(1600);
-
-      if (gpibBus.isAsserted(NDAC_PIN)) {
-        gpibBus.assertSignal(ATN_BIT);
-        gpibBus.writeByte(GC_UNL, false);
-        gpibBus.writeByte( (pri+0x20), false ); // LAD
 
+      if (found) {
         for (uint8_t sec=0x60; sec<0x7F; sec++){
-          gpibBus.writeByte(sec, false);
-          gpibBus.clearSignal(ATN_BIT);
-          delayMicroseconds(1600);
-          if (gpibBus.isAsserted(NDAC_PIN)) {
+          if (gpibBus.findListener(pri, sec, sec, &found) == ERR) break;
+          if (found) {
             if (acnt>0) dataPort.print(',');
             acnt++;
             dataPort.print(pri);
             dataPort.print(':');
             dataPort.print(sec);
-
-            gpibBus.assertSignal(ATN_BIT);
-            gpibBus.writeByte(GC_UNL, false);
-            gpibBus.writeByte((pri+0x20), false); // LAD
-          }else{
-            gpibBus.assertSignal(ATN_BIT);
-            gpibBus.writeByte(GC_UNT, false);
           }
-//          delayMicroseconds(50);
         }
-
-        gpibBus.clearSignal(ATN_BIT);
-        delayMicroseconds(1600);
-
       }
 
     } // End if NDAC aserted (else)
 
-    gpibBus.setControls(CIDS);
-//    delay(50);
     i++;
 
   } // END while
 
   dataPort.println();
-  gpibBus.cfg.rtmo = tmo;
+  gpibBus.setTimeout(0);
 //  if (xmit) gpibBus.sendCmd(GC_UNL);
   gpibBus.setControls(CIDS);
 
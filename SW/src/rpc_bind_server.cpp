@@ -24,51 +24,54 @@ void RPC_Bind_Server::begin(bool debug = false)
 /*!
   The loop() member function should be called by
   the main loop of the program to process any UDP or
-  TCP bind requests. It will only process requests if
-  the vxi_server is available. If so, it will hand off the
-  TCP or UDP request to process_request() for validation
-  and response. The response will be assembled by
-  process_request(), but it will be sent from loop() since
-  we know whether to send it via UDP or TCP.
+  TCP bind requests. It hands off the TCP or UDP request
+  to process_request() for validation and response. The
+  response will be assembled by process_request(), but it
+  will be sent from loop() since we know whether to send
+  it via UDP or TCP.
 */
 void RPC_Bind_Server::loop()
 {
-    /*  What to do if the vxi_server is busy?
-
-        There is no "out of resources" error code return from the
-        RPC BIND request. We could respond with PROC_UNAVAIL, but
-        that might suggest that the ESP simply cannot do RPC BIND
-        at all (as opposed to not right now). Another optioon is to
-        reject the message, but the enumerated reasons for rejection
-        (RPC_MISMATCH, AUTH_ERROR) do not seem appropriate. For now,
-        the solution is to ignore (not read) incoming requests until
-        a vxi_server becomes available.
-    */
-
-    if (vxi_server.have_free_connections()) {
-        
-        int len;
-
-        if (udp.parsePacket() > 0) {
-            len = get_bind_packet(udp);
-            if (len > 0) {
-                if (debug) debugPort.println(F("UDP packet received"));
-                process_request(true);
-                send_bind_packet(udp, sizeof(bind_response_packet));
+    /*  Requests are always read and answered, also when the vxi_server
+        has no free connections: a client that waits for an answer
+        retries with an increasing delay, which makes discovery slow.
+        A busy vxi_server is signalled with port 0 in the GET_PORT
+        response, as for a program that is not available.  */
+
+    int len;
+    uint8_t dump_buffer[PMAP_DUMP_ENTRIES * sizeof(pmap_entry_packet)]; // the packet classes have no default constructor, so use a plain buffer
+    pmap_entry_packet *entries = (pmap_entry_packet *)dump_buffer;
+    uint32_t nr_bytes;
+
+    if (udp.parsePacket() > 0) {
+        len = get_bind_packet(udp);
+        if (len > 0) {
+            if (debug) debugPort.println(F("UDP packet received"));
+            len = process_request(true);
+            if (len == 0) {
+                nr_bytes = fill_dump(entries);
+                send_bind_packet(udp, sizeof(rpc_response_packet), dump_buffer, nr_bytes);
+            } else {
+                send_bind_packet(udp, len);
             }
-        } else {
-            EthernetClient tcp_client;
-            tcp_client = tcp.accept();
-            if (tcp_client) {
-                len = get_bind_packet(tcp_client);
-                if (len > 0) {
-                    if (debug) debugPort.println(F("TCP packet received"));
-                    process_request(false);
-                    send_bind_packet(tcp_client, sizeof(bind_response_packet));
-                }
-                tcp_client.stop(); // close the connection
+        }
+    }
+
+    EthernetClient tcp_client;
+    tcp_client = tcp.accept();
+    if (tcp_client) {
+        len = get_bind_packet(tcp_client);
+        if (len > 0) {
+            if (debug) debugPort.println(F("TCP packet received"));
+            len = process_request(false);
+            if (len == 0) {
+                nr_bytes = fill_dump(entries);
+                send_bind_packet(tcp_client, sizeof(rpc_response_packet), dump_buffer, nr_bytes);
+            } else {
+                send_bind_packet(tcp_client, len);
             }
         }
+        tcp_client.stop(); // close the connection
     }
 }
 
@@ -77,63 +80,121 @@ void RPC_Bind_Server::loop()
           for both TCP and UDP servers.
 
   This function checks to see if the incoming request is a valid
-  PORT_MAP request. It assembles the response including a
-  success or error code and the port passed by the VXI_Server.
-  Actually sending the response is handled by the caller.
+  PORTMAP request. It assembles the response including a
+  success or error code and, for GET_PORT, the port passed by the
+  VXI_Server. Actually sending the response is handled by the caller.
 
   @param  onUDP   Indicates whether the server calling on this
                   function is UDP or TCP.
+  @return The length of the response, or 0 for a PMAP_DUMP request,
+          of which the caller must send the entries (see fill_dump()).
 */
-void RPC_Bind_Server::process_request(bool onUDP)
+uint32_t RPC_Bind_Server::process_request(bool onUDP)
 {
-    uint32_t rc = rpc::SUCCESS;
     uint32_t port = 0;
 
     rpc_request_packet *rpc_request = (onUDP ? udp_request : tcp_request);
+    rpc_response_packet *rpc_response = (onUDP ? udp_response : tcp_response);
+    bind_request_packet *bind_request = (onUDP ? udp_bind_request : tcp_bind_request);
     bind_response_packet *bind_response = (onUDP ? udp_bind_response : tcp_bind_response);
 
     if (rpc_request->program != rpc::PORTMAP) {
-        rc = rpc::PROG_UNAVAIL;
-
         if (debug) {
             debugPort.print(F("ERROR: Invalid program (expected PORTMAP = 0x186A0; received 0x"));
             debugPort.printf("%08x)\n", (uint32_t)(rpc_request->program));
         }
-    } else if (rpc_request->procedure != rpc::GET_PORT) {
-        rc = rpc::PROC_UNAVAIL;
+        rpc_response->rpc_status = rpc::PROG_UNAVAIL;
+        return sizeof(rpc_response_packet);
+    }
 
-        if (debug) {
-            debugPort.print(F("ERROR: Invalid procedure (expected GET_PORT = 3; received "));
-            debugPort.printf("%u)\n", (uint32_t)(rpc_request->procedure));
-        }
-    } else {
-        // i.e., if it is a valid PORTMAP request
+    switch (rpc_request->procedure) {
+    case rpc::PMAP_NULL:
+        if (debug) debugPort.println(F("PORTMAP NULL received"));
+        rpc_response->rpc_status = rpc::SUCCESS;
+        return sizeof(rpc_response_packet);
+
+    case rpc::PMAP_DUMP:
+        if (debug) debugPort.println(F("PORTMAP DUMP received"));
+        rpc_response->rpc_status = rpc::SUCCESS;
+        return 0;
+
+    case rpc::GET_PORT:
         if (debug) {
             debugPort.print(F("PORTMAP command received on "));
             debugPort.println(onUDP?F("UDP"):F("TCP"));
         }
-        
-        port = vxi_server.allocate();
-
-        /*  The logic in the loop() routine should not allow
-            the port returned to be zero, since we first checked
-            to see if the vxi_server was available. However, we are
-            including the following test just in case.
-        */
-
-        if (port == 0) {
-            rc = rpc::GARBAGE_ARGS; // not really the appropriate response, but we need to signal failure somehow!
-            if (debug) {
-                debugPort.println(F("ERROR: PORTMAP failed: vxi_server not available."));
-            }
-        } else {
-            if (debug) {
+        if (bind_request->getport_protocol != rpc::PROT_TCP) {
+            // port 0: not available
+        } else if (bind_request->getport_program == rpc::VXI_11_CORE) {
+            port = vxi_server.allocate();
+        } else if (bind_request->getport_program == rpc::VXI_11_ASYNC) {
+            port = vxi_server.async_port();
+        }
+
+        if (debug) {
+            if (port == 0) {
+                debugPort.println(F("PORTMAP: not available (vxi_server busy, or not a VXI-11 program on TCP)"));
+            } else {
                 debugPort.print(F("PORTMAP: assigned to port "));
                 debugPort.printf("%d\n", port);
             }
         }
+        bind_response->rpc_status = rpc::SUCCESS;
+        bind_response->vxi_port = port;
+        return sizeof(bind_response_packet);
+
+    default:
+        if (debug) {
+            debugPort.print(F("ERROR: Invalid procedure (expected NULL, GET_PORT or DUMP; received "));
+            debugPort.printf("%u)\n", (uint32_t)(rpc_request->procedure));
+        }
+        rpc_response->rpc_status = rpc::PROC_UNAVAIL;
+        return sizeof(rpc_response_packet);
     }
+}
+
+/*!
+  @brief  Fill in the list of programs for a PMAP_DUMP response.
+
+  @param  entries Room for PMAP_DUMP_ENTRIES entries.
+  @return The number of bytes to send from entries, including the
+          final value_follows of 0.
+*/
+uint32_t RPC_Bind_Server::fill_dump(pmap_entry_packet *entries)
+{
+    int n = 0;
+
+    entries[n].value_follows = 1;
+    entries[n].program = rpc::PORTMAP;
+    entries[n].version = 2;
+    entries[n].protocol = rpc::PROT_TCP;
+    entries[n++].port = rpc::BIND_PORT;
+
+    entries[n].value_follows = 1;
+    entries[n].program = rpc::PORTMAP;
+    entries[n].version = 2;
+    entries[n].protocol = rpc::PROT_UDP;
+    entries[n++].port = rpc::BIND_PORT;
+
+    // every port the VXI server listens on, not only the one GET_PORT answers with now
+    for (int i = 0; i < VXI11_PORTS; i++) {
+        entries[n].value_follows = 1;
+        entries[n].program = rpc::VXI_11_CORE;
+        entries[n].version = 1;
+        entries[n].protocol = rpc::PROT_TCP;
+        entries[n++].port = vxi_server.port() + i;
+    }
+
+    if (vxi_server.async_port() != 0) {
+        entries[n].value_follows = 1;
+        entries[n].program = rpc::VXI_11_ASYNC;
+        entries[n].version = 1;
+        entries[n].protocol = rpc::PROT_TCP;
+        entries[n++].port = vxi_server.async_port();
+    }
+
+    // end of the list: only a value_follows of 0
+    entries[n].value_follows = 0;
 
-    bind_response->rpc_status = rc;
-    bind_response->vxi_port = port;
+    return n * sizeof(pmap_entry_packet) + 4;
 }
@@ -9,6 +9,7 @@
 #include "vxi_server.h"
 #include <Ethernet.h>
 #include "rpc_enums.h"
+#include "rpc_packets.h"
 
 /*!
   @brief  Listens for and responds to PORT_MAP requests.
@@ -16,11 +17,13 @@
   The RPC_Bind_Server class listens for incoming PORT_MAP requests
   on port 111, both on UDP and TCP. When a request comes in, it asks
   the VXI_Server (passed as part of the construction of the class)
-  for the current port and returns a response accordingly. Note that
+  for the current port and returns a response accordingly. Requests
+  are always answered, also when the VXI_Server is busy. Note that
   the VXI_Server must be constructed before the RPC_Bind_Server.
 */
 class RPC_Bind_Server
 {
+    static const int PMAP_DUMP_ENTRIES = 4 + VXI11_PORTS; ///< Programs listed in a PMAP_DUMP response (each VXI-11 port once), plus 1 for the end of the list
 
   public:
     /*!
@@ -56,7 +59,8 @@ class RPC_Bind_Server
     void loop();
 
   protected:
-    void process_request(bool onUDP);
+    uint32_t process_request(bool onUDP);
+    uint32_t fill_dump(pmap_entry_packet *entries);
     bool debug;
 
     VXI_Server &vxi_server;   ///< Reference to the VXI_Server
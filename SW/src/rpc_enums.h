@@ -21,16 +21,12 @@ namespace rpc
   @brief  Port numbers used in the RPC and VXI communication.
 
   Bind requests always come in on port 111, via either UDP or TCP.
-  Some clients (Siglent oscilloscopes for example) require a different port per link; therefore
-  it is possible to cycle through a block of ports, changing each time VXI_Server
-  begins listening for a new link request.
-  Keeping START and END the same will allow for mDNS publication of the VXI_Server port.
+  The block of ports for the VXI transactions is set with VXI11_PORT
+  and VXI11_PORTS in config.h.
 */
 enum ports {
 
-    BIND_PORT = 111,       ///< Port to listen on for bind requests
-    VXI_PORT_START = 9010, ///< Start of a block of ports to use for VXI transactions
-    VXI_PORT_END = 9010    ///< End of a block of ports to use for VXI transactions
+    BIND_PORT = 111        ///< Port to listen on for bind requests
 };
 
 /*!
@@ -97,8 +93,10 @@ enum rpc_status {
 */
 enum programs {
 
-    PORTMAP = 0x186A0,    ///< Request for the port on which the VXI_Server is listening
-    VXI_11_CORE = 0x607AF ///< Request for a VXI command to be executed
+    PORTMAP = 0x186A0,     ///< Request for the port on which the VXI_Server is listening
+    VXI_11_CORE = 0x607AF, ///< Request for a VXI command to be executed
+    VXI_11_ASYNC = 0x607B0, ///< Request to abort a VXI command in progress (on the abort port)
+    VXI_11_INTR = 0x607B1   ///< Service request sent by us to the client (on the interrupt channel)
 };
 
 /*!
@@ -106,11 +104,42 @@ enum programs {
 */
 enum procedures {
 
+    PMAP_NULL = 0,           ///< Do nothing, used to check that the port mapper is there (program PORTMAP)
+    VXI_11_NULL = 0,         ///< Do nothing, used to check that the VXI server is there (program VXI_11_CORE)
+    VXI_11_DEV_ABORT = 1,    ///< Abort a read or write in progress (program VXI_11_ASYNC)
     GET_PORT = 3,            ///< Return the port on which the VXI_Server is currently listening
+    PMAP_DUMP = 4,           ///< Return the list of all programs and their ports (program PORTMAP)
     VXI_11_CREATE_LINK = 10, ///< Create a link to handle a series of requests
     VXI_11_DEV_WRITE = 11,   ///< Write to the AWG
     VXI_11_DEV_READ = 12,    ///< Read from the AWG
-    VXI_11_DESTROY_LINK = 23 ///< Destroy the link and cycle to the next port
+    VXI_11_DEV_READSTB = 13, ///< Read the status byte (serial poll)
+    VXI_11_DEV_TRIGGER = 14, ///< Send a group execute trigger
+    VXI_11_DEV_CLEAR = 15,   ///< Send a selected device clear
+    VXI_11_DEV_REMOTE = 16,  ///< Put the device in remote state
+    VXI_11_DEV_LOCAL = 17,   ///< Put the device in local state (go to local)
+    VXI_11_DEV_ENABLE_SRQ = 20,    ///< Enable or disable the service request callback
+    VXI_11_DESTROY_LINK = 23,      ///< Destroy the link and cycle to the next port
+    VXI_11_CREATE_INTR_CHAN = 25,  ///< Open the interrupt channel to the client
+    VXI_11_DESTROY_INTR_CHAN = 26, ///< Close the interrupt channel
+    VXI_11_DEV_INTR_SRQ = 30       ///< Service request (program VXI_11_INTR, sent by us)
+};
+
+/*!
+  @brief  Protocols in the port mapper requests and responses.
+*/
+enum protocols {
+
+    PROT_TCP = 6, ///< TCP
+    PROT_UDP = 17 ///< UDP
+};
+
+/*!
+  @brief  Protocol of the interrupt channel requested in CREATE_INTR_CHAN.
+*/
+enum intr_family {
+
+    INTR_TCP = 0, ///< TCP, the only one supported
+    INTR_UDP = 1  ///< UDP
 };
 
 /*!
@@ -129,6 +158,7 @@ enum errors {
     DEVICE_LOCKED = 11,    ///< The device has been locked by another process
     NO_LOCK_HELD = 12,     ///< The device has not been properly locked
     IO_TIMEOUT = 15,       ///< The requested data was not sent/received within the specified timeout interval
+    IO_ERROR = 17,         ///< The device did not respond or the bus failed
     LOCK_TIMEOUT = 17,     ///< Unable to secure a lock on the device within the specified timeout interval
     INVALID_ADDRESS = 21,  ///< No device exists at the specified address
     ABORT = 23,            ///< An abort command has come in via another RPC port
@@ -145,4 +175,14 @@ enum reasons {
     REQCNT = 1 ///< Data reached the maximum count requested
 };
 
+/*!
+  @brief  Bits of the flags field in VXI_11 requests.
+*/
+enum flags {
+
+    FLAG_WAITLOCK = 0x01,  ///< Wait for a lock instead of returning DEVICE_LOCKED
+    FLAG_END = 0x08,       ///< On a write: this is the last chunk of the data (send EOI)
+    FLAG_TERMCHRSET = 0x80 ///< On a read: the term_char field is valid
+};
+
 }; // namespace rpc
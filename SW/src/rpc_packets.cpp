@@ -16,6 +16,63 @@ uint8_t tcp_send_buffer[TCP_SEND_SIZE]; // only for tcp bind responses
 uint8_t vxi_read_buffer[VXI_READ_SIZE]; // only for vxi requests
 uint8_t vxi_send_buffer[VXI_SEND_SIZE]; // only for vxi responses
 
+static const uint8_t zero_padding[3] = {0, 0, 0}; // to fill a packet to a multiple of 4 bytes
+
+/*!
+  @brief  Write data to a TCP connection, in pieces that fit the free
+          space in the socket.
+
+  The data is only handed over to the socket, it is not waited for
+  until it has been sent. If the client does not make room within
+  VXI_TX_TIMEOUT, the connection is stopped, so that a stuck client
+  cannot block the main loop.
+
+  @param  tcp   The EthernetClient to which to write.
+  @param  data  The data to write.
+  @param  len   The length of the data.
+  @return true when all data was written.
+*/
+static bool write_tcp(EthernetClient &tcp, const uint8_t *data, uint32_t len)
+{
+    unsigned long start = millis();
+
+    while (len > 0) {
+        uint32_t room = tcp.availableForWrite();
+        if (room == 0) {
+            if (!tcp.connected() || (millis() - start > VXI_TX_TIMEOUT)) {
+                LOG_F("\nTimeout sending to %s:%d\n", tcp.remoteIP().toString().c_str(), tcp.remotePort());
+                tcp.stop();
+                return false;
+            }
+            continue; // wait for the client to make room
+        }
+        uint32_t n = tcp.write(data, min(len, room));
+        data += n;
+        len -= n;
+        start = millis();
+    }
+    return true;
+}
+
+/*!
+  @brief  Write an RPC record to a TCP connection: the prefix and packet
+          from the buffer, and the padding to a multiple of 4 bytes.
+
+  @param  tcp     The EthernetClient to which to write.
+  @param  buffer  The buffer holding the prefix, followed by the packet.
+  @param  len     The length of the packet (without prefix and padding).
+*/
+static void write_tcp_record(EthernetClient &tcp, uint8_t *buffer, uint32_t len)
+{
+    uint32_t padding = (4 - (len & 3)) & 3;
+
+    ((tcp_prefix_packet *)buffer)->length = 0x80000000 | (len + padding); // set the FRAG bit and the length;
+
+    if (write_tcp(tcp, buffer, len + 4)) { // add 4 to the length to account for the prefix
+        write_tcp(tcp, zero_padding, padding);
+    }
+}
+
 /*!
   @brief  Receive an RPC bind request packet via UDP.
 
@@ -70,34 +127,50 @@ uint32_t get_bind_packet(EthernetClient &tcp)
 }
 
 /*!
-  @brief  Receive an RPC/VXI command request packet via TCP.
+  @brief  Receive the prefix of an RPC/VXI command request via TCP.
 
-  This function is called only when the tcp client has data
-  available. It reads the data into the vxi_read_buffer.
+  This function is called only when the tcp client has at least
+  4 bytes available. It reads the prefix into the vxi_read_buffer.
 
   @param  tcp   The EthernetClient connection from which to read.
 
-  @return The length of data received.
+  @return The length of the packet that follows the prefix, 0 if the read failed.
 */
-uint32_t get_vxi_packet(EthernetClient &tcp)
+uint32_t get_vxi_prefix(EthernetClient &tcp)
 {
-    uint32_t len;
-
     vxi_request_prefix->length = 0; // set the length to zero in case the following read fails
 
-    tcp.readBytes(vxi_request_prefix_buffer, 4); // get the FRAG + LENGTH field
+    if (tcp.read(vxi_request_prefix_buffer, 4) != 4) { // get the FRAG + LENGTH field
+        return 0;
+    }
 
-    len = (vxi_request_prefix->length & 0x7fffffff); // mask out the FRAG bit
+    return (vxi_request_prefix->length & 0x7fffffff); // mask out the FRAG bit
+}
 
-    if (len > 4) {
-        len = min(len, (uint32_t)(VXI_READ_SIZE - 4)); // do not read more than the buffer can hold
+/*!
+  @brief  Receive an RPC/VXI command request packet via TCP.
 
-        tcp.readBytes(vxi_request_packet_buffer, len);
+  This function is called only when the tcp client has at least
+  len bytes available. It reads the data into the vxi_read_buffer,
+  right after the prefix.
 
-        LOG_F("\nReceived %d bytes from %s: %d\n", len + 4, tcp.remoteIP().toString().c_str(), tcp.remotePort());
-        LOG_DUMP(vxi_request_prefix_buffer, len + 4)
-        LOG_F("\n");
+  @param  tcp   The EthernetClient connection from which to read.
+  @param  len   The length of the packet, as returned by get_vxi_prefix().
+                Must not exceed VXI_READ_SIZE - 4.
+
+  @return The length of data received, 0 if the read failed.
+*/
+uint32_t get_vxi_packet(EthernetClient &tcp, uint32_t len)
+{
+    int rc = tcp.read(vxi_request_packet_buffer, len);
+    if (rc <= 0) {
+        return 0;
     }
+    len = rc;
+
+    LOG_F("\nReceived %d bytes from %s: %d\n", len + 4, tcp.remoteIP().toString().c_str(), tcp.remotePort());
+    LOG_DUMP(vxi_request_prefix_buffer, len + 4)
+    LOG_F("\n");
 
     return len;
 }
@@ -110,13 +183,19 @@ uint32_t get_vxi_packet(EthernetClient &tcp)
 
   @param  udp   The udp connection on which to send.
   @param  len	  The length of the response to send.
+  @param  extra Data to send after the response (e.g. for a response that
+                does not fit the buffer), or NULL.
+  @param  extra_len The length of the extra data, a multiple of 4.
 */
-void send_bind_packet(EthernetUDP &udp, uint32_t len)
+void send_bind_packet(EthernetUDP &udp, uint32_t len, const uint8_t *extra, uint32_t extra_len)
 {
     fill_response_header(udp_response_packet_buffer, udp_request->xid); // get the xid from the request
 
     udp.beginPacket(udp.remoteIP(), udp.remotePort());
     udp.write(udp_response_packet_buffer, len);
+    if (extra_len > 0) {
+        udp.write(extra, extra_len);
+    }
     udp.endPacket();
 
     LOG_F("\nSent %d bytes to %s:%d\n", len, udp.remoteIP().toString().c_str(), udp.remotePort());
@@ -132,24 +211,21 @@ void send_bind_packet(EthernetUDP &udp, uint32_t len)
 
   @param  tcp		The EthernetClient to which to send.
   @param  len		The length of the response to send.
+  @param  extra Data to send after the response (e.g. for a response that
+                does not fit the buffer), or NULL.
+  @param  extra_len The length of the extra data, a multiple of 4.
 */
-void send_bind_packet(EthernetClient &tcp, uint32_t len)
+void send_bind_packet(EthernetClient &tcp, uint32_t len, const uint8_t *extra, uint32_t extra_len)
 {
     fill_response_header(tcp_response_packet_buffer, tcp_request->xid); // get the xid from the request
 
-    // adjust length to multiple of 4, appending 0's to fill the dword
-
-    while ((len & 3) > 0) {
-        tcp_response_packet_buffer[len++] = 0;
-    }
-
-    tcp_response_prefix->length = 0x80000000 | len; // set the FRAG bit and the length;
+    // all responses are a multiple of 4 bytes, the extra data as well
 
-    while (tcp.availableForWrite() == 0)
-        ; // wait for tcp to be available
+    tcp_response_prefix->length = 0x80000000 | (len + extra_len); // set the FRAG bit and the length;
 
-    tcp.write(tcp_response_prefix_buffer, len + 4); // add 4 to the length to account for the tcp_response_prefix
-    tcp.flush();
+    if (write_tcp(tcp, tcp_response_prefix_buffer, len + 4)) { // add 4 to the length to account for the tcp_response_prefix
+        write_tcp(tcp, extra, extra_len);
+    }
 
     LOG_F("\nSent %d bytes to %s:%d\n", len, tcp.remoteIP().toString().c_str(), tcp.remotePort());
     LOG_DUMP(tcp_response_prefix_buffer, len + 4)
@@ -172,19 +248,44 @@ void send_vxi_packet(EthernetClient &tcp, uint32_t len)
 {
     fill_response_header(vxi_response_packet_buffer, vxi_request->xid);
 
-    // adjust length to multiple of 4, appending 0's to fill the dword
+    // the data of a read response is already in place behind the header,
+    // so the whole record goes out in one piece, plus the padding
 
-    while ((len & 3) > 0) {
-        vxi_response_packet_buffer[len++] = 0;
-    }
+    write_tcp_record(tcp, vxi_response_prefix_buffer, len);
+
+    LOG_F("\nSent %d bytes to %s:%d\n", len, tcp.remoteIP().toString().c_str(), tcp.remotePort());
+    LOG_DUMP(vxi_response_prefix_buffer, len + 4)
+    LOG_F("\n");
+}
 
-    vxi_response_prefix->length = 0x80000000 | len; // set the FRAG bit and the length;
+/*!
+  @brief  Send a VXI service request (DEV_INTR_SRQ) via TCP.
 
-    while (tcp.availableForWrite() == 0)
-        ; // wait for tcp to be available
+  This is a call from us to the client, on the interrupt channel.
+  The handle must already be in intr_srq_request. The reply of the
+  client is of no interest, the caller discards it. It uses the
+  vxi_send_buffer, so it must not be called while a response is
+  being prepared there.
 
-    tcp.write(vxi_response_prefix_buffer, len + 4); // add 4 to the length to account for the vxi_response_prefix
-    tcp.flush();
+  @param  tcp		The EthernetClient of the interrupt channel.
+  @param  len		The length of the request to send.
+*/
+void send_intr_packet(EthernetClient &tcp, uint32_t len)
+{
+    static uint32_t xid = 0;
+
+    intr_srq_request->xid = ++xid;
+    intr_srq_request->msg_type = rpc::CALL;
+    intr_srq_request->rpc_version = 2;
+    intr_srq_request->program = rpc::VXI_11_INTR;
+    intr_srq_request->program_version = 1;
+    intr_srq_request->procedure = rpc::VXI_11_DEV_INTR_SRQ;
+    intr_srq_request->credentials_l = 0;
+    intr_srq_request->credentials_h = 0;
+    intr_srq_request->verifier_l = 0;
+    intr_srq_request->verifier_h = 0;
+
+    write_tcp_record(tcp, vxi_response_prefix_buffer, len);
 
     LOG_F("\nSent %d bytes to %s:%d\n", len, tcp.remoteIP().toString().c_str(), tcp.remotePort());
     LOG_DUMP(vxi_response_prefix_buffer, len + 4)
@@ -8,6 +8,7 @@
 
 #include "utilities.h"
 #include <Ethernet.h>
+#include "config.h"
 
 /*  The get functions take the connection (UDP or TCP client),
     read the available data, and return the length of data
@@ -16,16 +17,27 @@
 
 uint32_t get_bind_packet(EthernetUDP &udp);
 uint32_t get_bind_packet(EthernetClient &tcp);
-uint32_t get_vxi_packet(EthernetClient &tcp);
+
+/*  The VXI server reads its records in two steps, so that it never has
+    to block on a client that has only sent part of a record: first the
+    4-byte prefix (record mark), then the packet itself. Both functions
+    must only be called when the requested amount of data is available.
+*/
+
+uint32_t get_vxi_prefix(EthernetClient &tcp);
+uint32_t get_vxi_packet(EthernetClient &tcp, uint32_t len);
 
 /*  The send functions take the connection (UDP or TCP client)
     and the length of the data to send; they send the data
-    and return void.
+    and return void. On TCP, they write as much as the socket
+    has room for, without waiting for the data to be sent. A client
+    that does not make room within VXI_TX_TIMEOUT is disconnected.
 */
 
-void send_bind_packet(EthernetUDP &udp, uint32_t len);
-void send_bind_packet(EthernetClient &tcp, uint32_t len);
+void send_bind_packet(EthernetUDP &udp, uint32_t len, const uint8_t *extra = NULL, uint32_t extra_len = 0);
+void send_bind_packet(EthernetClient &tcp, uint32_t len, const uint8_t *extra = NULL, uint32_t extra_len = 0);
 void send_vxi_packet(EthernetClient &tcp, uint32_t len);
+void send_intr_packet(EthernetClient &tcp, uint32_t len);
 
 /*  The send functions call on fill_response_header to generate
     the "generic" data used in all responses.
@@ -181,6 +193,21 @@ struct bind_response_packet {
     big_endian_32_t vxi_port;    ///< The port on which the VXI_Server is currently listening
 };
 
+/*!
+  @brief  Structure of one entry in the response to a PMAP_DUMP request.
+
+  The response is the basic RPC response followed by a list of these
+  entries, and a final value_follows of 0. It does not fit the bind
+  send buffers, so it is sent in pieces (see send_bind_packet()).
+*/
+struct pmap_entry_packet {
+    big_endian_32_t value_follows; ///< 1: an entry follows
+    big_endian_32_t program;       ///< Program code (see rpc::programs)
+    big_endian_32_t version;       ///< Program version
+    big_endian_32_t protocol;      ///< Protocol (see rpc::protocols)
+    big_endian_32_t port;          ///< Port on which the program listens
+};
+
 /*!
   @brief  Structure of the VXI_11_CREATE_LINK request packet.
 
@@ -282,11 +309,11 @@ struct read_request_packet {
     big_endian_32_t verifier_l;      ///< Security data (not used in this context)
     big_endian_32_t verifier_h;      ///< Security data (not used in this context)
     big_endian_32_t link_id;         ///< Unique link id generated for this session (see CREATE_LINK)
-    big_endian_32_t request_size;    ///< Maximum amount of data requested (we will assume that we never send more than can be received))
+    big_endian_32_t request_size;    ///< Maximum amount of data requested (a longer response is sent in chunks, see rpc::REQCNT)
     big_endian_32_t io_timeout;      ///< How long to wait before timing out the data request (we will ignore)
     big_endian_32_t lock_timeout;    ///< How long to wait before timing out a lock request (we will ignore)
-    big_endian_32_t flags;           ///< Used to indicate whether an "end" character is supplied (we will ignore)
-    char term_char;                  ///< The "end" character (we will ignore)
+    big_endian_32_t flags;           ///< Used to indicate whether an "end" character is supplied (see rpc::FLAG_TERMCHRSET)
+    big_endian_32_t term_char;       ///< The "end" character (a char takes 4 bytes in RPC, it is in the lowest byte)
 };
 
 /*!
@@ -331,7 +358,7 @@ struct write_request_packet {
     big_endian_32_t link_id;         ///< Unique link id generated for this session (see CREATE_LINK)
     big_endian_32_t io_timeout;      ///< How long to wait before timing out the data request (we will ignore)
     big_endian_32_t lock_timeout;    ///< How long to wait before timing out a lock request (we will ignore)
-    big_endian_32_t flags;           ///< Used to indicate whether an "end" character is supplied (we will ignore)
+    big_endian_32_t flags;           ///< Used to indicate whether this is the last chunk of the data (see rpc::FLAG_END)
     big_endian_32_t data_len;        ///< Length of the data sent
     char data[];                     ///< The data sent
 };
@@ -353,6 +380,169 @@ struct write_response_packet {
     big_endian_32_t size;        ///< Number of bytes sent
 };
 
+/*!
+  @brief  Structure of the VXI_11_DEV_ABORT request packet.
+
+  The abort request comes in on the abort port, and includes the
+  link id of the link for which the operation must be aborted.
+*/
+struct abort_request_packet {
+    big_endian_32_t xid;             ///< Transaction id (should be checked to make sure it matches, but we will just pass it back)
+    big_endian_32_t msg_type;        ///< Message type (see rpc::msg_type)
+    big_endian_32_t rpc_version;     ///< RPC protocol version (should be 2, but we can ignore)
+    big_endian_32_t program;         ///< Program code (see rpc::programs)
+    big_endian_32_t program_version; ///< Program version - what version of the program is requested (we can ignore)
+    big_endian_32_t procedure;       ///< Procedure code (see rpc::procedures)
+    big_endian_32_t credentials_l;   ///< Security data (not used in this context)
+    big_endian_32_t credentials_h;   ///< Security data (not used in this context)
+    big_endian_32_t verifier_l;      ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;      ///< Security data (not used in this context)
+    big_endian_32_t link_id;         ///< Link id of the operation to abort (see CREATE_LINK)
+};
+
+/*!
+  @brief  Structure of the VXI_11_DEV_ABORT response packet.
+
+  In addition to the basic RPC response data, the DEV_ABORT response
+  includes an error field (e.g., to signal an invalid link id).
+*/
+struct abort_response_packet {
+    big_endian_32_t xid;         ///< Transaction id (we just pass it back what we received in the request)
+    big_endian_32_t msg_type;    ///< Message type (see rpc::msg_type)
+    big_endian_32_t reply_state; ///< Accepted or rejected (see rpc::reply_state)
+    big_endian_32_t verifier_l;  ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;  ///< Security data (not used in this context)
+    big_endian_32_t rpc_status;  ///< Status of accepted message (see rpc::rpc_status)
+    big_endian_32_t error;       ///< Error code (see rpc::errors)
+};
+
+/*!
+  @brief  Structure of the generic VXI_11 request packet.
+
+  Used by DEV_READSTB, DEV_TRIGGER, DEV_CLEAR, DEV_REMOTE and DEV_LOCAL.
+  In addition to the basic RPC request data, it includes the link id,
+  flags and timeouts.
+*/
+struct generic_request_packet {
+    big_endian_32_t xid;             ///< Transaction id (should be checked to make sure it matches, but we will just pass it back)
+    big_endian_32_t msg_type;        ///< Message type (see rpc::msg_type)
+    big_endian_32_t rpc_version;     ///< RPC protocol version (should be 2, but we can ignore)
+    big_endian_32_t program;         ///< Program code (see rpc::programs)
+    big_endian_32_t program_version; ///< Program version - what version of the program is requested (we can ignore)
+    big_endian_32_t procedure;       ///< Procedure code (see rpc::procedures)
+    big_endian_32_t credentials_l;   ///< Security data (not used in this context)
+    big_endian_32_t credentials_h;   ///< Security data (not used in this context)
+    big_endian_32_t verifier_l;      ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;      ///< Security data (not used in this context)
+    big_endian_32_t link_id;         ///< Unique link id generated for this session (see CREATE_LINK)
+    big_endian_32_t flags;           ///< Flags (we will ignore)
+    big_endian_32_t lock_timeout;    ///< How long to wait before timing out a lock request (we will ignore)
+    big_endian_32_t io_timeout;      ///< How long to wait before timing out the operation (we will ignore)
+};
+
+/*!
+  @brief  Structure of the VXI_11_DEV_READSTB response packet.
+
+  In addition to the basic RPC response data, the DEV_READSTB response
+  includes an error field and the status byte.
+*/
+struct readstb_response_packet {
+    big_endian_32_t xid;         ///< Transaction id (we just pass it back what we received in the request)
+    big_endian_32_t msg_type;    ///< Message type (see rpc::msg_type)
+    big_endian_32_t reply_state; ///< Accepted or rejected (see rpc::reply_state)
+    big_endian_32_t verifier_l;  ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;  ///< Security data (not used in this context)
+    big_endian_32_t rpc_status;  ///< Status of accepted message (see rpc::rpc_status)
+    big_endian_32_t error;       ///< Error code (see rpc::errors)
+    big_endian_32_t stb;         ///< The status byte (in the lowest byte)
+};
+
+/*!
+  @brief  Structure of the VXI_11_DEV_ENABLE_SRQ request packet.
+
+  In addition to the basic RPC request data, the DEV_ENABLE_SRQ request
+  includes the link id, whether service requests must be sent, and a
+  handle (up to 40 bytes) that is to be returned with each service request.
+*/
+struct enable_srq_request_packet {
+    big_endian_32_t xid;             ///< Transaction id (should be checked to make sure it matches, but we will just pass it back)
+    big_endian_32_t msg_type;        ///< Message type (see rpc::msg_type)
+    big_endian_32_t rpc_version;     ///< RPC protocol version (should be 2, but we can ignore)
+    big_endian_32_t program;         ///< Program code (see rpc::programs)
+    big_endian_32_t program_version; ///< Program version - what version of the program is requested (we can ignore)
+    big_endian_32_t procedure;       ///< Procedure code (see rpc::procedures)
+    big_endian_32_t credentials_l;   ///< Security data (not used in this context)
+    big_endian_32_t credentials_h;   ///< Security data (not used in this context)
+    big_endian_32_t verifier_l;      ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;      ///< Security data (not used in this context)
+    big_endian_32_t link_id;         ///< Unique link id generated for this session (see CREATE_LINK)
+    big_endian_32_t enable;          ///< Non-zero to enable the service requests
+    big_endian_32_t handle_len;      ///< Length of the handle
+    uint8_t handle[];                ///< The handle (padded to a multiple of 4 bytes)
+};
+
+/*!
+  @brief  Structure of the VXI_11_CREATE_INTR_CHAN request packet.
+
+  In addition to the basic RPC request data, the CREATE_INTR_CHAN request
+  includes the address and port on which the client listens for the
+  service requests, and the program and protocol it expects.
+*/
+struct create_intr_request_packet {
+    big_endian_32_t xid;             ///< Transaction id (should be checked to make sure it matches, but we will just pass it back)
+    big_endian_32_t msg_type;        ///< Message type (see rpc::msg_type)
+    big_endian_32_t rpc_version;     ///< RPC protocol version (should be 2, but we can ignore)
+    big_endian_32_t program;         ///< Program code (see rpc::programs)
+    big_endian_32_t program_version; ///< Program version - what version of the program is requested (we can ignore)
+    big_endian_32_t procedure;       ///< Procedure code (see rpc::procedures)
+    big_endian_32_t credentials_l;   ///< Security data (not used in this context)
+    big_endian_32_t credentials_h;   ///< Security data (not used in this context)
+    big_endian_32_t verifier_l;      ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;      ///< Security data (not used in this context)
+    big_endian_32_t host_addr;       ///< IPv4 address of the client
+    big_endian_32_t host_port;       ///< Port on which the client listens
+    big_endian_32_t prog_num;        ///< Program number of the interrupt channel (should be VXI_11_INTR)
+    big_endian_32_t prog_vers;       ///< Program version of the interrupt channel (we can ignore)
+    big_endian_32_t prog_family;     ///< Protocol of the interrupt channel (see rpc::intr_family)
+};
+
+/*!
+  @brief  Structure of a response packet that holds only an error code.
+
+  Used for the DEV_TRIGGER, DEV_CLEAR, DEV_REMOTE, DEV_LOCAL, DEV_ENABLE_SRQ,
+  CREATE_INTR_CHAN and DESTROY_INTR_CHAN responses.
+*/
+struct error_response_packet {
+    big_endian_32_t xid;         ///< Transaction id (we just pass it back what we received in the request)
+    big_endian_32_t msg_type;    ///< Message type (see rpc::msg_type)
+    big_endian_32_t reply_state; ///< Accepted or rejected (see rpc::reply_state)
+    big_endian_32_t verifier_l;  ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;  ///< Security data (not used in this context)
+    big_endian_32_t rpc_status;  ///< Status of accepted message (see rpc::rpc_status)
+    big_endian_32_t error;       ///< Error code (see rpc::errors)
+};
+
+/*!
+  @brief  Structure of the VXI_11_DEV_INTR_SRQ request packet.
+
+  This is a call from us to the client, on the interrupt channel. It
+  holds the handle that the client gave in DEV_ENABLE_SRQ.
+*/
+struct intr_srq_request_packet {
+    big_endian_32_t xid;             ///< Transaction id (we count up)
+    big_endian_32_t msg_type;        ///< Message type (see rpc::msg_type)
+    big_endian_32_t rpc_version;     ///< RPC protocol version (2)
+    big_endian_32_t program;         ///< Program code (VXI_11_INTR)
+    big_endian_32_t program_version; ///< Program version (1)
+    big_endian_32_t procedure;       ///< Procedure code (VXI_11_DEV_INTR_SRQ)
+    big_endian_32_t credentials_l;   ///< Security data (not used in this context)
+    big_endian_32_t credentials_h;   ///< Security data (not used in this context)
+    big_endian_32_t verifier_l;      ///< Security data (not used in this context)
+    big_endian_32_t verifier_h;      ///< Security data (not used in this context)
+    big_endian_32_t handle_len;      ///< Length of the handle
+    uint8_t handle[];                ///< The handle (padded to a multiple of 4 bytes)
+};
+
 /*  constant variables used to access the data buffers as the various structures defined above  */
 
 rpc_request_packet *const udp_request = (rpc_request_packet *)udp_request_packet_buffer;     ///< udp_request accesses the udp_request_packet_buffer as a generic rpc request
@@ -370,6 +560,12 @@ tcp_prefix_packet *const tcp_response_prefix = (tcp_prefix_packet *)tcp_response
 bind_request_packet *const tcp_bind_request = (bind_request_packet *)tcp_request_packet_buffer;     ///< tcp_bind_request accesses the tcp_request_packet_buffer as an rpc bind request
 bind_response_packet *const tcp_bind_response = (bind_response_packet *)tcp_response_packet_buffer; ///< tcp_bind_response accesses the tcp_response_packet_buffer as an rpc bind response
 
+/*  The abort channel uses the small tcp buffers as well. It can be serviced in the middle of
+    a VXI read or write (which use the vxi buffers), but never in the middle of a bind request.  */
+
+abort_request_packet *const abort_request = (abort_request_packet *)tcp_request_packet_buffer;     ///< abort_request accesses the tcp_request_packet_buffer as an abort request
+abort_response_packet *const abort_response = (abort_response_packet *)tcp_response_packet_buffer; ///< abort_response accesses the tcp_response_packet_buffer as an abort response
+
 rpc_request_packet *const vxi_request = (rpc_request_packet *)vxi_request_packet_buffer;     ///< vxi_request accesses the vxi_request_packet_buffer as a generic rpc request
 rpc_response_packet *const vxi_response = (rpc_response_packet *)vxi_response_packet_buffer; ///< vxi_response accesses the vxi_response_packet_buffer as a generic rpc response
 
@@ -387,3 +583,12 @@ read_response_packet *const read_response = (read_response_packet *)vxi_response
 
 write_request_packet *const write_request = (write_request_packet *)vxi_request_packet_buffer;     ///< write_request accesses the vxi_request_packet_buffer as a write request
 write_response_packet *const write_response = (write_response_packet *)vxi_response_packet_buffer; ///< write_response accesses the vxi_response_packet_buffer as a write response
+
+generic_request_packet *const generic_request = (generic_request_packet *)vxi_request_packet_buffer;       ///< generic_request accesses the vxi_request_packet_buffer as a generic VXI_11 request
+readstb_response_packet *const readstb_response = (readstb_response_packet *)vxi_response_packet_buffer;  ///< readstb_response accesses the vxi_response_packet_buffer as a read status byte response
+
+enable_srq_request_packet *const enable_srq_request = (enable_srq_request_packet *)vxi_request_packet_buffer;     ///< enable_srq_request accesses the vxi_request_packet_buffer as an enable srq request
+create_intr_request_packet *const create_intr_request = (create_intr_request_packet *)vxi_request_packet_buffer;  ///< create_intr_request accesses the vxi_request_packet_buffer as a create interrupt channel request
+error_response_packet *const error_response = (error_response_packet *)vxi_response_packet_buffer;                ///< error_response accesses the vxi_response_packet_buffer as a response with only an error code
+
+intr_srq_request_packet *const intr_srq_request = (intr_srq_request_packet *)vxi_response_packet_buffer; ///< intr_srq_request accesses the vxi_response_packet_buffer as a service request (we send it)
@@ -4,9 +4,22 @@
 
 
 VXI_Server::VXI_Server(SCPI_handler_interface &scpi_handler)
-    : scpi_handler(scpi_handler)
+    : next_port(VXI11_PORT, VXI11_PORT + VXI11_PORTS - 1), scpi_handler(scpi_handler)
 {
-    tcp_server = NULL;
+    for (int i = 0; i < VXI11_PORTS; i++) {
+        tcp_servers[i] = NULL;
+    }
+    abort_server = NULL;
+    abort_port = 0;
+    busy_link = -1;
+    aborted = false;
+    intr_slot = -1;
+    srq_link = -1;
+    for (int i = 0; i < MAX_VXI_LINKS; i++) {
+        links[i].slot = -1;
+    }
+    srq_state = false;
+    srq_handle_len = 0;
 }
 
 VXI_Server::~VXI_Server()
@@ -37,41 +50,132 @@ uint32_t VXI_Server::allocate()
     uint32_t port = 0;
 
     if (have_free_connections()) {
-        port = vxi_port; // This can be a cyclic counter, not a simple integer
+        port = next_port++; // round robin over the listening ports
     }
     return port;
 }
 
 /**
- * @brief Start the VXI server on the specified port.
+ * @brief Start the VXI server on the specified port, and the VXI11_PORTS - 1 ports after it.
  * 
- * @param port TCP port to listen on
+ * @param port first TCP port to listen on
  * @param debug true when debug messages are to be printed
  */
 void VXI_Server::begin(uint32_t port, bool debug = false)
 {
     this->vxi_port = port;
     this->debug = debug;
+    next_port = cyclic_uint32_t(port, port + VXI11_PORTS - 1);
 
-    if (tcp_server) {
-        delete tcp_server;
-        tcp_server = NULL;
+    for (int i = 0; i < VXI11_PORTS; i++) {
+        if (tcp_servers[i]) {
+            delete tcp_servers[i];
+            tcp_servers[i] = NULL;
+        }
+
+        tcp_servers[i] = new EthernetServer(port + i);
+        if (!tcp_servers[i]) {
+            if (debug) {
+                debugPort.print(F("ERROR: Failed to create TCP server on port "));
+                debugPort.printf("%u\n", (uint32_t)(port + i));
+            }
+            continue;
+        }
+
+        if (debug) {
+            debugPort.print(F("VXI server listening on port "));
+            debugPort.printf("%u\n", (uint32_t)(port + i));
+        }
+        tcp_servers[i]->begin();
     }
+}
 
-    tcp_server = new EthernetServer(vxi_port);
-    if (!tcp_server) {
+/**
+ * @brief Start the abort channel (VXI-11 DEVICE_ASYNC) on the specified port.
+ * 
+ * The port is advertised in the CREATE_LINK response. Without this call,
+ * no abort channel is advertised. Call after begin().
+ * 
+ * @param port TCP port to listen on
+ */
+void VXI_Server::begin_abort(uint32_t port)
+{
+    if (abort_server) {
+        delete abort_server;
+        abort_server = NULL;
+    }
+
+    abort_server = new EthernetServer(port);
+    if (!abort_server) {
         if (debug) {
-            debugPort.print(F("ERROR: Failed to create TCP server on port "));
-            debugPort.printf("%u\n", (uint32_t)vxi_port);
+            debugPort.print(F("ERROR: Failed to create abort server on port "));
+            debugPort.printf("%u\n", (uint32_t)port);
+        }
+        abort_port = 0;
+        return;
+    }
+
+    if (debug) {
+        debugPort.print(F("VXI abort channel listening on port "));
+        debugPort.printf("%u\n", (uint32_t)port);
+    }
+    abort_server->begin();
+    abort_port = port;
+}
+
+/**
+ * @brief Service the abort channel.
+ * 
+ * Call this from the main loop, and while a read or write is in progress
+ * (via the idle callback of the bus). It never blocks: a DEVICE_ABORT request
+ * is only handled once it has completely arrived. Only one abort client
+ * is served at a time.
+ */
+void VXI_Server::poll_abort()
+{
+    if (!abort_server) {
+        return;
+    }
+
+    if (abort_client && !abort_client.connected()) {
+        abort_client.stop();
+    }
+    if (!abort_client) {
+        abort_client = abort_server->accept();
+        if (!abort_client) {
+            return;
         }
+    }
+
+    if (abort_client.available() < (int)(4 + sizeof(abort_request_packet))) {
         return;
     }
 
+    get_bind_packet(abort_client);
+
+    if (abort_request->program != rpc::VXI_11_ASYNC || abort_request->procedure != rpc::VXI_11_DEV_ABORT) {
+        abort_response->rpc_status = (abort_request->program != rpc::VXI_11_ASYNC) ? rpc::PROG_UNAVAIL : rpc::PROC_UNAVAIL;
+        send_bind_packet(abort_client, sizeof(rpc_response_packet));
+        return;
+    }
+
+    uint32_t link_id = abort_request->link_id;
+    abort_response->rpc_status = rpc::SUCCESS;
+    if (link_id >= MAX_VXI_LINKS || links[link_id].slot < 0) {
+        abort_response->error = rpc::INVALID_LINK;
+    } else {
+        abort_response->error = rpc::NO_ERROR;
+        if ((int)link_id == busy_link && !aborted) {
+            aborted = true;
+            scpi_handler.abort();
+        }
+    }
     if (debug) {
-        debugPort.print(F("VXI server listening on port "));
-        debugPort.printf("%u\n", (uint32_t)vxi_port);
+        debugPort.print(F("DEVICE ABORT LID="));
+        debugPort.print(link_id);
+        debugPort.println(((int)link_id == busy_link) ? F(" (busy)") : F(" (idle)"));
     }
-    tcp_server->begin();
+    send_bind_packet(abort_client, sizeof(abort_response_packet));
 }
 
 /**
@@ -81,36 +185,38 @@ void VXI_Server::begin(uint32_t port, bool debug = false)
  */
 int VXI_Server::loop()
 {
+    poll_abort();
+    poll_srq();
+
     // This is a TCP server based on 'server.accept()', meaning I must handle the lifecycle of the client 
-    // It is blocking for input and output
+    // Input is handled without blocking, output is blocking
 
     // close any clients that are not connected
     for (int i = 0; i < MAX_VXI_CLIENTS; i++) {
         if (clients[i] && !clients[i].connected()) {
-            clients[i].stop();
             if (debug) {
-                debugPort.print(F("Force Closing VXI connection on port "));
-                debugPort.print((uint32_t)vxi_port);
-                debugPort.print(F(" of slot "));
-                debugPort.print(i);
-                debugPort.print(F(" from remote port "));
-                debugPort.println(clients[i].remotePort());
-            }               
+                debugPort.print(F("Force "));
+            }
+            close_client(i);
         }
     }
 
-    if (have_free_connections()) {
+    for (int p = 0; p < VXI11_PORTS && have_free_connections(); p++) {
+        if (!tcp_servers[p]) {
+            continue;
+        }
         // check if a new client is available
-        EthernetClient newClient = tcp_server->accept();
+        EthernetClient newClient = tcp_servers[p]->accept();
         if (newClient) {
             bool found = false;
             for (int i = 0; i < MAX_VXI_CLIENTS; i++) {
                 if (!clients[i]) {
                     clients[i] = newClient;
+                    rx_state[i] = rx_prefix;
                     found = true;
                     if (debug) {
                         debugPort.print(F("New VXI connection on port "));
-                        debugPort.print((uint32_t)vxi_port);
+                        debugPort.print(newClient.localPort());
                         debugPort.print(F(" in slot "));
                         debugPort.print(i);
                         debugPort.print(F(" from remote port "));
@@ -123,7 +229,7 @@ int VXI_Server::loop()
                 // shouldn't happen, but still....
                 if (debug) {
                     debugPort.print(F("VXI connection limit reached on port "));
-                    debugPort.print((uint32_t)vxi_port);
+                    debugPort.print(newClient.localPort());
                     debugPort.print(F(" from remote port "));
                     debugPort.println(newClient.remotePort());
                 }
@@ -132,39 +238,158 @@ int VXI_Server::loop()
         }
     }
 
-    // handle any incoming data
+    // handle any incoming data, without blocking on clients that have only sent part of a record
     for (int i = 0; i < MAX_VXI_CLIENTS; i++) {
-        if (clients[i] && clients[i].available()) // if a connection has been established on port
-        {
-            bool bClose = false;
-            // read the entire packet, blocking if needed. The packet is small in general, so should have arrived completely
-            // TODO: make this work in a non blocking way
-            int len = get_vxi_packet(clients[i]);
-
-            if (len > 0) {
-                bClose = handle_packet(clients[i], i);
+        if (clients[i] && receive_packet(i)) {
+            if (handle_packet(clients[i], i)) {
+                close_client(i);
+            }
+        }
+    }
+    return nr_connections();
+}
+
+/**
+ * @brief Advance the receive state machine of a client slot.
+ * 
+ * Reads only what is available, so this never blocks. A record that has
+ * not completely arrived yet stays in the socket buffer until the next call.
+ * 
+ * @param slot the client slot
+ * @return true when a complete request is in the vxi_read_buffer, ready to be handled
+ */
+bool VXI_Server::receive_packet(int slot)
+{
+    EthernetClient &client = clients[slot];
+    uint32_t avail = client.available();
+
+    if (rx_state[slot] == rx_discard) {
+        // the record was bigger than the buffer. Drop the rest of it.
+        while (avail > 0 && rx_len[slot] > 0) {
+            uint32_t len = min(min(avail, rx_len[slot]), (uint32_t)(VXI_READ_SIZE - 4));
+            int rc = client.read(vxi_request_packet_buffer, len);
+            if (rc <= 0) {
+                break;
             }
+            avail -= rc;
+            rx_len[slot] -= rc;
+        }
+        if (rx_len[slot] > 0) {
+            return false;
+        }
+        rx_state[slot] = rx_prefix;
+    }
 
-            if (bClose) {
-                if (debug) {
-                    debugPort.print(F("Closing VXI connection on port "));
-                    debugPort.print((uint32_t)vxi_port);
-                    debugPort.print(F(" of slot "));
-                    debugPort.print(i);
-                    debugPort.print(F(" from remote port "));
-                    debugPort.println(clients[i].remotePort());
-                }
-                clients[i].stop();
+    if (rx_state[slot] == rx_prefix) {
+        if (avail < 4) {
+            return false;
+        }
+        rx_len[slot] = get_vxi_prefix(client);
+        avail -= 4;
+        // a record without a complete rpc header cannot be handled, and
+        // after it the stream cannot be trusted to be in sync any more
+        if (rx_len[slot] < sizeof(rpc_request_packet)) {
+            if (debug) {
+                debugPort.print(F("Invalid VXI record length in slot "));
+                debugPort.println(slot);
             }
+            close_client(slot);
+            return false;
         }
+        rx_start[slot] = millis();
+        rx_state[slot] = rx_body;
     }
-    return nr_connections();
+
+    // rx_body: wait until the part of the record that fits the buffer is there
+    uint32_t len = min(rx_len[slot], (uint32_t)(VXI_READ_SIZE - 4));
+    if (avail < len) {
+        if (millis() - rx_start[slot] > VXI_RX_TIMEOUT) {
+            if (debug) {
+                debugPort.print(F("Timeout receiving VXI request in slot "));
+                debugPort.println(slot);
+            }
+            close_client(slot);
+        }
+        return false;
+    }
+
+    if (get_vxi_packet(client, len) != len) {
+        close_client(slot);
+        return false;
+    }
+    rx_len[slot] -= len;
+    rx_state[slot] = (rx_len[slot] > 0) ? rx_discard : rx_prefix;
+    return true;
+}
+
+/**
+ * @brief Close the connection of a client slot.
+ * 
+ * @param slot the client slot
+ */
+void VXI_Server::close_client(int slot)
+{
+    if (debug) {
+        debugPort.print(F("Closing VXI connection on port "));
+        debugPort.print((uint32_t)vxi_port);
+        debugPort.print(F(" of slot "));
+        debugPort.print(slot);
+        debugPort.print(F(" from remote port "));
+        debugPort.println(clients[slot].remotePort());
+    }
+    clients[slot].stop();
+    rx_state[slot] = rx_prefix;
+    // the links of the connection go with it
+    for (int i = 0; i < MAX_VXI_LINKS; i++) {
+        if (links[i].slot == slot) {
+            links[i].slot = -1;
+            if (i == srq_link) {
+                srq_link = -1;
+            }
+        }
+    }
+    if (slot == intr_slot) {
+        close_intr_chan();
+    }
+}
+
+/**
+ * @brief Find the link a request is about.
+ * 
+ * @param slot the client slot on which the request came in
+ * @param link_id the link id in the request
+ * @return the link, or -1 when the link id is not valid for this connection
+ */
+int VXI_Server::find_link(int slot, uint32_t link_id)
+{
+    if (link_id >= MAX_VXI_LINKS || links[link_id].slot != slot) {
+        return -1;
+    }
+    return (int)link_id;
+}
+
+/**
+ * @brief Check whether a connection still has links.
+ * 
+ * @param slot the client slot
+ * @return true when at least one link was created over this connection
+ */
+bool VXI_Server::have_links(int slot)
+{
+    for (int i = 0; i < MAX_VXI_LINKS; i++) {
+        if (links[i].slot == slot) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool VXI_Server::handle_packet(EthernetClient &client, int slot)
 {
     bool bClose = false;
     uint32_t rc = rpc::SUCCESS;
+    uint32_t procedure = vxi_request->procedure;
+    int link = -1;
 
     if (vxi_request->program != rpc::VXI_11_CORE) {
         rc = rpc::PROG_UNAVAIL;
@@ -173,30 +398,83 @@ bool VXI_Server::handle_packet(EthernetClient &client, int slot)
             debugPort.print(F("ERROR: Invalid program (expected VXI_11_CORE = 0x607AF; received 0x"));
             debugPort.printf("%08x)\n", (uint32_t)(vxi_request->program));
         }
+    } else if (procedure != rpc::VXI_11_NULL &&
+               procedure != rpc::VXI_11_CREATE_LINK &&
+               procedure != rpc::VXI_11_CREATE_INTR_CHAN &&
+               procedure != rpc::VXI_11_DESTROY_INTR_CHAN) {
+        /*  All other requests start with the link id, right after the rpc header.  */
+        link = find_link(slot, destroy_request->link_id);
+        if (link < 0) {
+            if (debug) {
+                debugPort.print(F("ERROR: Invalid link id "));
+                debugPort.print((uint32_t)destroy_request->link_id);
+                debugPort.print(F(" in slot "));
+                debugPort.println(slot);
+            }
+            /*  The response must have the layout of the procedure, with the error set.  */
+            uint32_t size = sizeof(error_response_packet);
+            if (procedure == rpc::VXI_11_DEV_READ) {
+                size = sizeof(read_response_packet);
+            } else if (procedure == rpc::VXI_11_DEV_WRITE) {
+                size = sizeof(write_response_packet);
+            } else if (procedure == rpc::VXI_11_DEV_READSTB) {
+                size = sizeof(readstb_response_packet);
+            }
+            memset(vxi_response_packet_buffer, 0, size);
+            error_response->rpc_status = rpc::SUCCESS;
+            error_response->error = rpc::INVALID_LINK;
+            send_vxi_packet(client, size);
+            return false;
+        }
+    }
 
-    } else
-        switch (vxi_request->procedure) {
+    /*  rc is already set when the program is wrong.  */
+    if (rc == rpc::SUCCESS) {
+        switch (procedure) {
+        case rpc::VXI_11_NULL:
+            vxi_response->rpc_status = rpc::SUCCESS;
+            send_vxi_packet(client, sizeof(rpc_response_packet));
+            break;
         case rpc::VXI_11_CREATE_LINK:
             create_link(client, slot);
             break;
         case rpc::VXI_11_DEV_READ:
-            read(client, slot);
+            read(client, link);
             break;
         case rpc::VXI_11_DEV_WRITE:
-            write(client, slot);
+            write(client, link);
             break;
         case rpc::VXI_11_DESTROY_LINK:
-            destroy_link(client, slot);
-            bClose = true;
+            destroy_link(client, link);
+            bClose = !have_links(slot); // close the connection with its last link
+            break;
+        case rpc::VXI_11_DEV_READSTB:
+            readstb(client, link);
+            break;
+        case rpc::VXI_11_DEV_TRIGGER:
+        case rpc::VXI_11_DEV_CLEAR:
+        case rpc::VXI_11_DEV_REMOTE:
+        case rpc::VXI_11_DEV_LOCAL:
+            generic(client, link, procedure);
+            break;
+        case rpc::VXI_11_DEV_ENABLE_SRQ:
+            enable_srq(client, link);
+            break;
+        case rpc::VXI_11_CREATE_INTR_CHAN:
+            create_intr_chan(client, slot);
+            break;
+        case rpc::VXI_11_DESTROY_INTR_CHAN:
+            destroy_intr_chan(client, slot);
             break;
         default:
             if (debug) {
                 debugPort.print(F("Invalid VXI-11 procedure (received "));
-                debugPort.printf("%u)\n", (uint32_t)(vxi_request->procedure));
+                debugPort.printf("%u)\n", procedure);
             }
             rc = rpc::PROC_UNAVAIL;
             break;
         }
+    }
 
     /*  Response messages will be sent by the various routines above
         when the program and procedure are recognized (and therefore
@@ -208,7 +486,7 @@ bool VXI_Server::handle_packet(EthernetClient &client, int slot)
         send_vxi_packet(client, sizeof(rpc_response_packet));
     }
 
-    /*  signal to caller whether the connection should be close (i.e., DESTROY_LINK)  */
+    /*  signal to caller whether the connection should be close (i.e., DESTROY_LINK of the last link)  */
 
     return bClose;
 }
@@ -220,7 +498,15 @@ void VXI_Server::create_link(EthernetClient &client, int slot)
         be null-terminated, but just in case, we will put in
         the terminator.  */
 
-    if (!scpi_handler.claim_control()) {
+    int link = -1;
+    for (int i = 0; i < MAX_VXI_LINKS; i++) {
+        if (links[i].slot < 0) {
+            link = i;
+            break;
+        }
+    }
+
+    if (link < 0 || !scpi_handler.claim_control()) {
         create_response->rpc_status = rpc::SUCCESS;
         create_response->error = rpc::OUT_OF_RESOURCES; // not DEVICE_LOCKED because that would require lock_timeout etc
         create_response->link_id = 0;
@@ -236,8 +522,10 @@ void VXI_Server::create_link(EthernetClient &client, int slot)
         debugPort.print(create_request->data);
         debugPort.print(F("\" on port "));
         debugPort.print((uint32_t)vxi_port);
-        debugPort.print(F(" -> LID="));
+        debugPort.print(F(" in slot "));
         debugPort.print(slot);
+        debugPort.print(F(" -> LID="));
+        debugPort.print(link);
         debugPort.println();
     }
     // interpret and store the request data so that I can use it on the GPIB bus
@@ -272,22 +560,27 @@ void VXI_Server::create_link(EthernetClient &client, int slot)
         return;
     }
     // store
-    addresses[slot] = my_nr;
+    links[link].slot = slot;
+    links[link].address = my_nr;
     
     /*  Generate the response  */
     create_response->rpc_status = rpc::SUCCESS;
     create_response->error = rpc::NO_ERROR;
-    create_response->link_id = slot;
-    create_response->abort_port = 0;
+    create_response->link_id = link;
+    create_response->abort_port = abort_port;
     create_response->max_receive_size = VXI_READ_SIZE - 4;
     send_vxi_packet(client, sizeof(create_response_packet));
 }
 
-void VXI_Server::destroy_link(EthernetClient &client, int slot)
+void VXI_Server::destroy_link(EthernetClient &client, int link)
 {
+    links[link].slot = -1;
+    if (link == srq_link) {
+        srq_link = -1;
+    }
     if (debug) {
         debugPort.print(F("DESTROY LINK LID="));
-        debugPort.print(slot);
+        debugPort.print(link);
         debugPort.print(F(" on port "));
         debugPort.print((uint32_t)vxi_port);
         debugPort.println();        
@@ -298,64 +591,291 @@ void VXI_Server::destroy_link(EthernetClient &client, int slot)
     scpi_handler.release_control();
 }
 
-void VXI_Server::read(EthernetClient &client, int slot)
+void VXI_Server::read(EthernetClient &client, int link)
 {
-    // This is where we read from the device
-    char outbuffer[256];
+    // This is where we read from the device. The data goes directly into the response packet.
+    // The response is limited to what the client requested and to what fits the send buffer.
+    // If the device has more data, the next DEVICE_READ continues the transfer. The reason is then
+    // REQCNT when request_size has been reached, or none (0) when the send buffer was the limit.
+    const size_t max_data_len = VXI_SEND_SIZE - 4 - sizeof(read_response_packet);
+    size_t max_len = min((size_t)read_request->request_size, max_data_len);
     size_t len = 0;
-    bool rv = scpi_handler.read(addresses[slot], outbuffer, &len, sizeof(outbuffer));
-
-    // FIXME handle error codes, maybe even pick up errors from the SCPI Parser
+    uint32_t reason = rpc::REQCNT;
+    uint32_t error = rpc::NO_ERROR;
+    int term_char = (read_request->flags & rpc::FLAG_TERMCHRSET) ? (int)(read_request->term_char & 0xFF) : -1;
+    aborted = false;
+    if (max_len > 0) {
+        scpi_handler.set_timeout(read_request->io_timeout);
+        busy_link = link; // the abort channel may stop the read from here on
+        if (!scpi_handler.read(links[link].address, read_response->data, &len, max_len, &reason, term_char)) {
+            error = rpc::IO_TIMEOUT;
+        }
+        busy_link = -1;
+    }
+    if (aborted) {
+        error = rpc::ABORT;
+    }
+    if (reason == rpc::REQCNT && len < read_request->request_size) {
+        reason = 0; // a partial response, the client's request count has not been satisfied
+    }
 
     if (debug) {
         debugPort.print(F("READ DATA LID="));
-        debugPort.print(slot);
+        debugPort.print(link);
         debugPort.print(F(" on port "));
         debugPort.printf("%u", (uint32_t)vxi_port);
         debugPort.print(F("; gpib_address="));
-        debugPort.print(addresses[slot]);
+        debugPort.print(links[link].address);
+        debugPort.print(F("; reason="));
+        debugPort.print(reason);
+        debugPort.print(F("; error="));
+        debugPort.print(error);
         debugPort.print(F("; data = "));
-        printBuf(outbuffer, (int)len);
+        printBuf(read_response->data, (int)len);
     }
     read_response->rpc_status = rpc::SUCCESS;
-    read_response->error = rpc::NO_ERROR;
-    read_response->reason = rpc::END;
+    read_response->error = error;
+    read_response->reason = reason;
     read_response->data_len = (uint32_t)len;
-    strcpy(read_response->data, outbuffer);
 
     send_vxi_packet(client, sizeof(read_response_packet) + len);
 }
 
-void VXI_Server::write(EthernetClient &client, int slot)
+void VXI_Server::write(EthernetClient &client, int link)
 {
-    // This is where we write to the device
+    // This is where we write to the device.
+    // Clients split long writes in chunks of max_receive_size, only the last one has the END flag.
+    const uint32_t max_data_len = VXI_READ_SIZE - 4 - sizeof(write_request_packet);
     uint32_t wlen = write_request->data_len;
-    uint32_t len = wlen;
-    // right trim. SCPI parser doesn't like \r\n
-    while (len > 0 && isspace(write_request->data[len - 1])) {
-        len--;
+    uint32_t len = min(wlen, max_data_len); // do not trust data_len beyond what fits the buffer
+    uint32_t accepted = len;                 // reported back: the client sends the rest again
+    // the end of a chunk that did not fit is not the end of the data
+    bool end = (write_request->flags & rpc::FLAG_END) != 0 && wlen <= max_data_len;
+    if (end) {
+        // right trim the last chunk. SCPI parser doesn't like \r\n
+        while (len > 0 && isspace(write_request->data[len - 1])) {
+            len--;
+        }
     }
-    write_request->data[len] = 0;
     if (debug) {
         debugPort.print(F("WRITE DATA LID="));
-        debugPort.print(slot);
+        debugPort.print(link);
         debugPort.print(F(" on port "));
         debugPort.print((uint32_t)vxi_port);
         debugPort.print(F("; gpib_address="));
-        debugPort.print(addresses[slot]);        
-        debugPort.print(F("; data = "));
+        debugPort.print(links[link].address);        
+        debugPort.print(end ? F("; data = ") : F("; partial data = "));
         printBuf(write_request->data, (int)len);
     }
     /*  Parse and respond to the SCPI command  */
-    scpi_handler.write(addresses[slot], write_request->data, len);
+    uint32_t error = rpc::NO_ERROR;
+    aborted = false;
+    scpi_handler.set_timeout(write_request->io_timeout);
+    busy_link = link; // the abort channel may stop the write from here on
+    if (!scpi_handler.write(links[link].address, write_request->data, len, end)) {
+        error = rpc::IO_TIMEOUT;
+    }
+    busy_link = -1;
+    if (aborted) {
+        error = rpc::ABORT;
+    }
 
     /*  Generate the response  */
     write_response->rpc_status = rpc::SUCCESS;
-    write_response->error = rpc::NO_ERROR;
-    write_response->size = wlen; // with the original length
+    write_response->error = error;
+    write_response->size = (error == rpc::NO_ERROR) ? accepted : 0; // before the trim
     send_vxi_packet(client, sizeof(write_response_packet));
 }
 
+void VXI_Server::readstb(EthernetClient &client, int link)
+{
+    uint8_t stb = 0;
+    scpi_handler.set_timeout(generic_request->io_timeout);
+    bool ok = scpi_handler.readstb(links[link].address, &stb);
+
+    if (debug) {
+        debugPort.print(F("READSTB LID="));
+        debugPort.print(link);
+        debugPort.print(F("; gpib_address="));
+        debugPort.print(links[link].address);
+        debugPort.print(F("; stb="));
+        debugPort.println(ok ? stb : -1);
+    }
+    readstb_response->rpc_status = rpc::SUCCESS;
+    readstb_response->error = ok ? rpc::NO_ERROR : rpc::IO_ERROR;
+    readstb_response->stb = stb;
+    send_vxi_packet(client, sizeof(readstb_response_packet));
+}
+
+/**
+ * @brief Handle DEV_TRIGGER, DEV_CLEAR, DEV_REMOTE and DEV_LOCAL.
+ * 
+ * They all have the same request and response, and each maps to a GPIB command.
+ * 
+ * @param procedure the procedure requested
+ */
+void VXI_Server::generic(EthernetClient &client, int link, uint32_t procedure)
+{
+    bool ok = false;
+
+    scpi_handler.set_timeout(generic_request->io_timeout);
+    switch (procedure) {
+    case rpc::VXI_11_DEV_TRIGGER:
+        ok = scpi_handler.trigger(links[link].address);
+        break;
+    case rpc::VXI_11_DEV_CLEAR:
+        ok = scpi_handler.clear(links[link].address);
+        break;
+    case rpc::VXI_11_DEV_REMOTE:
+        ok = scpi_handler.remote(links[link].address);
+        break;
+    case rpc::VXI_11_DEV_LOCAL:
+        ok = scpi_handler.local(links[link].address);
+        break;
+    }
+    if (debug) {
+        debugPort.print(F("GENERIC PROC "));
+        debugPort.print(procedure);
+        debugPort.print(F(" LID="));
+        debugPort.print(link);
+        debugPort.print(F("; gpib_address="));
+        debugPort.print(links[link].address);
+        debugPort.println(ok ? F("; ok") : F("; failed"));
+    }
+    error_response->rpc_status = rpc::SUCCESS;
+    error_response->error = ok ? rpc::NO_ERROR : rpc::IO_ERROR;
+    send_vxi_packet(client, sizeof(error_response_packet));
+}
+
+void VXI_Server::enable_srq(EthernetClient &client, int link)
+{
+    // Only one link at a time gets the service requests, it is the same SRQ line for all of them anyway
+    bool enable = enable_srq_request->enable != 0;
+    uint32_t len = min((uint32_t)enable_srq_request->handle_len, (uint32_t)SRQ_HANDLE_SIZE);
+    uint32_t error = rpc::NO_ERROR;
+
+    if (enable && links[link].slot != intr_slot) {
+        // the requests go over the interrupt channel of the connection of the link
+        error = rpc::NO_CHANNEL;
+    } else if (enable) {
+        memcpy(srq_handle, enable_srq_request->handle, len);
+        srq_handle_len = len;
+        srq_link = link;
+        srq_state = false; // a device that already requests service is reported right away
+    } else if (link == srq_link) {
+        srq_link = -1;
+    }
+    if (debug) {
+        debugPort.print(F("ENABLE SRQ LID="));
+        debugPort.print(link);
+        debugPort.print(enable ? F(" on") : F(" off"));
+        debugPort.printf("; error=%u\n", error);
+    }
+    error_response->rpc_status = rpc::SUCCESS;
+    error_response->error = error;
+    send_vxi_packet(client, sizeof(error_response_packet));
+}
+
+void VXI_Server::create_intr_chan(EthernetClient &client, int slot)
+{
+    uint32_t host_addr = create_intr_request->host_addr;
+    uint32_t host_port = create_intr_request->host_port;
+    uint32_t error = rpc::NO_ERROR;
+
+    if (create_intr_request->prog_family != rpc::INTR_TCP) {
+        error = rpc::INVALID_OPERATION;
+    } else if (intr_slot == slot) {
+        error = rpc::DUPLICATE_CHANNEL;
+    } else if (intr_slot >= 0) {
+        error = rpc::OUT_OF_RESOURCES; // only one interrupt channel, it costs a socket
+    } else {
+        IPAddress ip = IPAddress(host_addr >> 24, host_addr >> 16, host_addr >> 8, host_addr);
+        intr_client.setConnectionTimeout(VXI_INTR_CONNECT_TIMEOUT);
+        if (intr_client.connect(ip, host_port)) {
+            intr_slot = slot;
+        } else {
+            intr_client.stop();
+            error = rpc::NO_CHANNEL;
+        }
+    }
+    if (debug) {
+        debugPort.print(F("CREATE INTR CHAN in slot "));
+        debugPort.print(slot);
+        debugPort.print(F(" to "));
+        debugPort.print(IPAddress(host_addr >> 24, host_addr >> 16, host_addr >> 8, host_addr));
+        debugPort.printf(":%u; error=%u\n", host_port, error);
+    }
+    error_response->rpc_status = rpc::SUCCESS;
+    error_response->error = error;
+    send_vxi_packet(client, sizeof(error_response_packet));
+}
+
+void VXI_Server::destroy_intr_chan(EthernetClient &client, int slot)
+{
+    if (debug) {
+        debugPort.print(F("DESTROY INTR CHAN in slot "));
+        debugPort.println(slot);
+    }
+    error_response->rpc_status = rpc::SUCCESS;
+    if (slot == intr_slot) {
+        close_intr_chan();
+        error_response->error = rpc::NO_ERROR;
+    } else {
+        error_response->error = rpc::NO_CHANNEL;
+    }
+    send_vxi_packet(client, sizeof(error_response_packet));
+}
+
+/**
+ * @brief Close the interrupt channel, if there is one.
+ */
+void VXI_Server::close_intr_chan()
+{
+    intr_client.stop();
+    intr_slot = -1;
+}
+
+/**
+ * @brief Send a service request to the client when the SRQ line gets asserted.
+ * 
+ * Called from the main loop, so the SRQ line is sampled between requests, and
+ * the vxi_send_buffer is free to build the request in. The line stays asserted
+ * until the device is serial polled, so only its assertion is reported.
+ */
+void VXI_Server::poll_srq()
+{
+    if (intr_slot < 0) {
+        return;
+    }
+    // the client replies to our requests, we have no use for that
+    while (intr_client.available() > 0) {
+        intr_client.read();
+    }
+    if (!intr_client.connected()) {
+        if (debug) {
+            debugPort.println(F("Interrupt channel closed by the client"));
+        }
+        close_intr_chan();
+        return;
+    }
+    // the request carries the handle of the link, so it must go to the connection of that link
+    if (srq_link < 0 || links[srq_link].slot != intr_slot) {
+        return;
+    }
+
+    bool srq = scpi_handler.srq();
+    if (srq && !srq_state) {
+        if (debug) {
+            debugPort.print(F("SRQ to LID="));
+            debugPort.println(srq_link);
+        }
+        intr_srq_request->handle_len = srq_handle_len;
+        memcpy(intr_srq_request->handle, srq_handle, srq_handle_len);
+        send_intr_packet(intr_client, sizeof(intr_srq_request_packet) + srq_handle_len);
+    }
+    srq_state = srq;
+}
+
 // const char *VXI_Server::get_visa_resource()
 // {
 //     static char visa_resource[40];
@@ -11,14 +11,37 @@ class SCPI_handler_interface
 {
   public:
     virtual ~SCPI_handler_interface() {} 
-    // write a command to the SCPI parser or device
-    virtual void write(int address, const char *data, size_t len) = 0;
-    // read a response from the SCPI parser or device
-    virtual bool read(int address, char *data, size_t *len, size_t max_len) = 0;
+    // write a command to the SCPI parser or device. When end is false, more data
+    // follows in the next write to the same address, and the device stays addressed.
+    // Returns false when the device did not accept all data in time.
+    virtual bool write(int address, const char *data, size_t len, bool end) = 0;
+    // read a response from the SCPI parser or device. At most max_len bytes are read.
+    // When term_char is not -1, the read also stops after that character.
+    // reason is set to rpc::END when the response is complete, to rpc::CHR when it stopped
+    // at term_char, or to rpc::REQCNT when the device has more data, which is returned
+    // by the next read to the same address.
+    // Returns false when the device did not complete the response in time.
+    virtual bool read(int address, char *data, size_t *len, size_t max_len, uint32_t *reason, int term_char) = 0;
+    // set_timeout() sets the time in ms the device gets for each following read or write as a whole,
+    // and for each step of the other operations
+    virtual void set_timeout(uint32_t io_timeout) = 0;
     // claim_control() should return true if the SCPI parser is ready to accept a command
     virtual bool claim_control() = 0;
     // release_control() should be called when the SCPI parser is no longer needed
     virtual void release_control() = 0;
+    // readstb() reads the status byte of the device (serial poll). Returns false when that failed.
+    virtual bool readstb(int address, uint8_t *stb) = 0;
+    // trigger(), clear(), remote() and local() send the corresponding GPIB commands to the device.
+    // They return false when that failed.
+    virtual bool trigger(int address) = 0;
+    virtual bool clear(int address) = 0;
+    virtual bool remote(int address) = 0;
+    virtual bool local(int address) = 0;
+    // abort() is called when the client asks to abort the read or write in progress.
+    // It is called from within that read or write, so it must only signal it to stop.
+    virtual void abort() = 0;
+    // srq() returns true while a device requests service (the SRQ line is asserted)
+    virtual bool srq() = 0;
 };
 
 /*!
@@ -34,6 +57,24 @@ class VXI_Server
         rt_parameters = 2
     };
 
+    /*  Receive state of a client slot. Records may arrive in pieces,
+        so every slot keeps track of where it is in the current record,
+        and the partial data stays in the socket buffer until the
+        whole record is available.  */
+    enum Rx_State {
+        rx_prefix = 0,  // waiting for the 4 byte record mark
+        rx_body = 1,    // waiting for the rest of the record
+        rx_discard = 2  // dropping the part of a record that does not fit the buffer
+    };
+
+    /*  A link is what the client creates with CREATE_LINK, for one instrument.
+        Links are independent of the connections: a client can create
+        several links over the same connection.  */
+    struct Link {
+        int8_t slot;      // the client slot of the connection that created the link, -1 when free
+        uint8_t address;  // the GPIB address of the instrument
+    };
+
   public:
     VXI_Server(SCPI_handler_interface &scpi_handler);
     // VXI_Server(SCPI_handler_interface &scpi_handler, uint32_t port_min, uint32_t port_max);
@@ -42,30 +83,60 @@ class VXI_Server
 
     int loop();
     void begin(uint32_t port, bool debug = false);
+    void begin_abort(uint32_t port);
+    void poll_abort();
+    void poll_srq();
     int nr_connections(void);
     bool have_free_connections(void);
 
     uint32_t allocate();
     uint32_t port() { return vxi_port; }
+    uint32_t async_port() { return abort_port; }
     // const char *get_visa_resource();
     // std::list<IPAddress> get_connected_clients();
     // void disconnect_client(const IPAddress &ip);
 
   protected:
     void create_link(EthernetClient &tcp, int slot);
-    void destroy_link(EthernetClient &tcp, int slot);
-    void read(EthernetClient &tcp, int slot);
-    void write(EthernetClient &tcp, int slot);
+    void destroy_link(EthernetClient &tcp, int link);
+    void read(EthernetClient &tcp, int link);
+    void write(EthernetClient &tcp, int link);
+    void readstb(EthernetClient &tcp, int link);
+    void generic(EthernetClient &tcp, int link, uint32_t procedure);
+    void enable_srq(EthernetClient &tcp, int link);
+    void create_intr_chan(EthernetClient &tcp, int slot);
+    void destroy_intr_chan(EthernetClient &tcp, int slot);
+    void close_intr_chan();
     bool handle_packet(EthernetClient &tcp, int slot);
+    int find_link(int slot, uint32_t link_id);
+    bool have_links(int slot);
+    bool receive_packet(int slot);
+    void close_client(int slot);
     void parse_scpi(char *buffer);
     bool debug;
 
-    EthernetServer *tcp_server;
+    EthernetServer *tcp_servers[VXI11_PORTS];  // one listener per port, for ports vxi_port .. vxi_port + VXI11_PORTS - 1
+    cyclic_uint32_t next_port;                  // the port the next GET_PORT answers with
     EthernetClient clients[MAX_VXI_CLIENTS];
-    uint8_t addresses[MAX_VXI_CLIENTS];
+    Link links[MAX_VXI_LINKS];
+    Rx_State rx_state[MAX_VXI_CLIENTS];
+    uint32_t rx_len[MAX_VXI_CLIENTS];          // bytes of the current record still to be received
+    unsigned long rx_start[MAX_VXI_CLIENTS];   // time at which the current record started to arrive
     Read_Type read_type;
     uint32_t rw_channel;
     uint32_t vxi_port;
+    EthernetServer *abort_server;
+    EthernetClient abort_client;
+    uint32_t abort_port;    // 0 when there is no abort channel
+    int busy_link;          // link of the read or write in progress, -1 when none
+    bool aborted;           // the read or write in progress has been aborted
+    static const uint8_t SRQ_HANDLE_SIZE = 40; // maximum size of the handle given in DEV_ENABLE_SRQ
+    EthernetClient intr_client;             // the interrupt channel to the client. There is only one.
+    int intr_slot;                          // slot of the link that created the interrupt channel, -1 when none
+    int srq_link;                           // link that enabled the service requests, -1 when none
+    bool srq_state;                         // last state of the SRQ line, to send a request only when it gets asserted
+    uint8_t srq_handle_len;
+    uint8_t srq_handle[SRQ_HANDLE_SIZE];    // handle to return in the service request
     SCPI_handler_interface &scpi_handler;
 };
 
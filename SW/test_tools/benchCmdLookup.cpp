@@ -0,0 +1,140 @@
+// Host benchmark of the ++command lookup of the Prologix server.
+//
+// Reads the tokens of cmdHidx from prologix_server.cpp, checks that they are
+// sorted the way getCmd() expects, and times the binary search of getCmd()
+// against the linear scan it replaced. The search loops are copies of those
+// in getCmd() (with strcasecmp instead of strcasecmp_P), so the time per
+// lookup is that of the host, but the number of compares is the same as on
+// the gateway.
+//
+// Build and run:
+//   g++ -O2 -o benchCmdLookup benchCmdLookup.cpp
+//   ./benchCmdLookup ../src/prologix_server.cpp
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+static const size_t CMD_TOKEN_SIZE = 12;  // as in prologix_server.cpp
+
+struct Token {
+    char token[CMD_TOKEN_SIZE];
+};
+
+static std::vector<Token> table;
+static unsigned long compares = 0;
+
+static bool readTable(const char *path) {
+    std::ifstream in(path);
+    std::string line;
+    bool inTable = false;
+
+    while (std::getline(in, line)) {
+        if (!inTable) {
+            inTable = line.find("cmdHidx [] PROGMEM") != std::string::npos;
+            continue;
+        }
+        if (line.find("};") != std::string::npos) break;
+        size_t start = line.find("{ \"");
+        if (start == std::string::npos) continue;
+        start += 3;
+        size_t end = line.find('"', start);
+        if (end == std::string::npos || end - start >= CMD_TOKEN_SIZE) {
+            printf("Bad token in line: %s\n", line.c_str());
+            return false;
+        }
+        Token t = {};
+        memcpy(t.token, line.data() + start, end - start);
+        table.push_back(t);
+    }
+    return !table.empty();
+}
+
+static int linearSearch(const char *token) {
+    int casize = table.size();
+    for (int i = 0; i < casize; i++) {
+        compares++;
+        if (strcasecmp(token, table[i].token) == 0) return i;
+    }
+    return casize;
+}
+
+static int binarySearch(const char *token) {
+    int casize = table.size();
+    int lo = 0;
+    int hi = casize - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        compares++;
+        int cmp = strcasecmp(token, table[mid].token);
+        if (cmp == 0) return mid;
+        if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return casize;
+}
+
+static void bench(const char *name, int (*search)(const char *), const std::vector<std::string> &tokens, int rounds) {
+    volatile int sink = 0;
+    compares = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const std::string &t : tokens) sink = sink + search(t.c_str());
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double lookups = (double)rounds * tokens.size();
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    printf("%-8s %8.1f ns per lookup, %5.1f compares per lookup\n", name, ns / lookups, compares / lookups);
+}
+
+int main(int argc, char **argv) {
+    const char *path = (argc > 1) ? argv[1] : "../src/prologix_server.cpp";
+    int rounds = (argc > 2) ? atoi(argv[2]) : 100000;
+
+    if (!readTable(path)) {
+        printf("No command table found in %s\n", path);
+        return 1;
+    }
+    printf("%zu commands in %s\n", table.size(), path);
+
+    // getCmd() only finds all commands when the table is sorted
+    bool sorted = true;
+    for (size_t i = 1; i < table.size(); i++) {
+        if (strcasecmp(table[i - 1].token, table[i].token) >= 0) {
+            printf("Not sorted: \"%s\" before \"%s\"\n", table[i - 1].token, table[i].token);
+            sorted = false;
+        }
+    }
+    for (const Token &t : table) {
+        if (binarySearch(t.token) == (int)table.size()) {
+            printf("Not found: \"%s\"\n", t.token);
+            sorted = false;
+        }
+    }
+    if (!sorted) return 1;
+
+    // every command once, in upper case as well, and some unknown tokens
+    std::vector<std::string> tokens;
+    for (const Token &t : table) {
+        std::string s = t.token;
+        tokens.push_back(s);
+        for (char &c : s) c = toupper(c);
+        tokens.push_back(s);
+    }
+    tokens.push_back("foo");
+    tokens.push_back("zzz");
+    tokens.push_back("a");
+
+    bench("linear", linearSearch, tokens, rounds);
+    bench("binary", binarySearch, tokens, rounds);
+    return 0;
+}
@@ -0,0 +1,74 @@
+import argparse
+import socket
+import time
+
+
+def read_line(sock, buf: bytearray) -> str:
+    while b"\n" not in buf:
+        data = sock.recv(1024)
+        if not data:
+            raise ConnectionError("Connection closed by the gateway")
+        buf.extend(data)
+    i = buf.index(b"\n")
+    line = buf[:i].decode(errors="replace").strip()
+    del buf[:i + 1]
+    return line
+
+
+def bench_round_trip(sock, addr: int, count: int) -> bool:
+    """Send "++addr N" + "++addr" pairs one at a time, waiting for each reply."""
+    buf = bytearray()
+    start = time.perf_counter()
+    for i in range(count):
+        sock.sendall(f"++addr {addr}\n++addr\n".encode())
+        r = read_line(sock, buf)
+        if r != str(addr):
+            print(f"\nUnexpected reply \"{r}\" on pair {i}")
+            return False
+    delta = time.perf_counter() - start
+    print(f"Round trip: {count} pairs in {delta * 1000:.1f} ms, {delta * 1000 / count:.3f} ms per pair.")
+    return True
+
+
+def bench_pipelined(sock, addr: int, count: int) -> bool:
+    """Send all "++addr N" + "++addr" pairs in one go, then read all replies."""
+    buf = bytearray()
+    msg = f"++addr {addr}\n++addr\n".encode() * count
+    start = time.perf_counter()
+    sock.sendall(msg)
+    for i in range(count):
+        r = read_line(sock, buf)
+        if r != str(addr):
+            print(f"\nUnexpected reply \"{r}\" on pair {i}")
+            return False
+    delta = time.perf_counter() - start
+    print(f"Pipelined: {count} pairs in {delta * 1000:.1f} ms, {delta * 1000 / count:.3f} ms per pair.")
+    return True
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Measure the time of ++ commands over the network, end to end (milliseconds). "
+                                                 "For the command lookup itself (microseconds), see benchCmdLookup.cpp. No instrument is needed.",
+                                     formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("host", help="IP address or name of the gateway.")
+    parser.add_argument("-p", type=int, default=1234, help="Port of the Prologix server.")
+    parser.add_argument("-n", type=int, default=1000, help="Number of ++addr set/query pairs per test.")
+    parser.add_argument("-a", type=int, default=5, help="GPIB address to set (the current address is restored at the end).")
+    parser.add_argument("-t", type=int, default=10000, help="Socket timeout in milliseconds.")
+    args = parser.parse_args()
+
+    print(f"Connecting to {args.host}:{args.p}")
+    sock = socket.create_connection((args.host, args.p), timeout=args.t / 1000)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    try:
+        buf = bytearray()
+        sock.sendall(b"++addr\n")
+        old_addr = read_line(sock, buf)
+        print(f"Current address: {old_addr}")
+        if bench_round_trip(sock, args.a, args.n):
+            bench_pipelined(sock, args.a, args.n)
+        sock.sendall(f"++addr {old_addr}\n".encode())
+    finally:
+        sock.close()
+
+    print("Done.")
@@ -0,0 +1,35 @@
+// Just enough of Arduino.h (MegaCoreX, ATmega4809) for AR488_Layouts.h on the host.
+// The port registers record the writes, see checkCtrlPortMap.cpp.
+
+#ifndef ARDUINO_H_HOST
+#define ARDUINO_H_HOST
+
+#include <stdint.h>
+
+#define HIGH 1
+#define LOW 0
+#define PIN_PC0 14  // MegaCoreX 48 pin standard variant
+
+struct Reg {
+    uint8_t value = 0;
+    int writes = 0;
+    Reg &operator=(uint8_t v) {
+        value = v;
+        writes++;
+        return *this;
+    }
+    operator uint8_t() const { return value; }
+};
+
+struct PORT_t {
+    Reg DIR, DIRSET, DIRCLR, OUT, OUTSET, OUTCLR, IN;
+};
+
+struct VPORT_t {
+    Reg DIR, OUT, IN;
+};
+
+extern PORT_t PORTC;
+extern VPORT_t VPORTC;
+
+#endif
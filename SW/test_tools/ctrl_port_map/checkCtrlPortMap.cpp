@@ -0,0 +1,128 @@
+// Host check of the GPIB control line mapping of the custom layout.
+//
+// Drives setGpibCtrlState(), setGpibCtrlDir() and getGpibPinState() from
+// AR488_Layouts.h with each control bit, and compares the PORTC register
+// writes with the pins of AR488_Config.h, translated to port bits with the
+// pin table of the MegaCoreX variant (not with the formula of the header).
+//
+// Build and run (from this directory):
+//   g++ -I. -I../../src -o checkCtrlPortMap checkCtrlPortMap.cpp
+//   ./checkCtrlPortMap
+
+#include <cstdio>
+
+#include "AR488_Layouts.h"
+
+PORT_t PORTC;
+VPORT_t VPORTC;
+
+// The control bits, as IFC_BIT .. ATN_BIT in AR488_GPIBbus.h
+struct CtrlLine {
+    const char *name;
+    uint8_t bit;
+    uint8_t pin;
+};
+
+static const CtrlLine lines[] = {
+    { "IFC",  1 << 0, IFC_PIN },
+    { "NDAC", 1 << 1, NDAC_PIN },
+    { "NRFD", 1 << 2, NRFD_PIN },
+    { "DAV",  1 << 3, DAV_PIN },
+    { "EOI",  1 << 4, EOI_PIN },
+    { "REN",  1 << 5, REN_PIN },
+    { "SRQ",  1 << 6, SRQ_PIN },
+    { "ATN",  1 << 7, ATN_PIN },
+};
+
+// MegaCoreX ATmega4809 48 pin standard variant: digital pin -> port and bit
+struct VariantPin {
+    uint8_t pin;
+    char port;
+    uint8_t bit;
+};
+
+static const VariantPin variant[] = {
+    { 14, 'C', 0 }, { 15, 'C', 1 }, { 16, 'C', 2 }, { 17, 'C', 3 },
+    { 18, 'C', 4 }, { 19, 'C', 5 }, { 20, 'C', 6 }, { 21, 'C', 7 },
+    { 22, 'D', 0 }, { 23, 'D', 1 }, { 24, 'D', 2 }, { 25, 'D', 3 },
+    { 26, 'D', 4 }, { 27, 'D', 5 }, { 28, 'D', 6 }, { 29, 'D', 7 },
+};
+
+static int errors = 0;
+
+static void resetPort() {
+    PORTC = PORT_t();
+    VPORTC = VPORT_t();
+}
+
+// One write of value to reg, and no write to other
+static void expectWrite(const char *what, const char *line, const Reg &reg, const Reg &other, uint8_t value) {
+    if (reg.writes != 1 || reg.value != value || other.writes != 0) {
+        printf("%s %s: wrote 0x%02X (%d writes, %d to the other register), expected 0x%02X\n",
+               what, line, reg.value, reg.writes, other.writes, value);
+        errors++;
+    }
+}
+
+int main() {
+    uint8_t all = 0;
+
+    for (const CtrlLine &l : lines) {
+        const VariantPin *vp = nullptr;
+        for (const VariantPin &v : variant) {
+            if (v.pin == l.pin) vp = &v;
+        }
+        if (!vp || vp->port != 'C') {
+            printf("%s: pin %u is not on PORTC\n", l.name, l.pin);
+            errors++;
+            continue;
+        }
+        uint8_t expected = 1 << vp->bit;
+        all |= expected;
+
+        resetPort();
+        setGpibCtrlState(0, l.bit);
+        expectWrite("assert", l.name, PORTC.OUTCLR, PORTC.OUTSET, expected);
+
+        resetPort();
+        setGpibCtrlState(l.bit, l.bit);
+        expectWrite("release", l.name, PORTC.OUTSET, PORTC.OUTCLR, expected);
+
+        resetPort();
+        setGpibCtrlDir(0, l.bit);
+        expectWrite("input", l.name, PORTC.DIRCLR, PORTC.DIRSET, expected);
+
+        resetPort();
+        setGpibCtrlDir(l.bit, l.bit);
+        expectWrite("output", l.name, PORTC.DIRSET, PORTC.DIRCLR, expected);
+
+        resetPort();
+        VPORTC.IN = expected;
+        if (getGpibPinState(l.pin) != HIGH) {
+            printf("read %s: LOW with PC%u HIGH\n", l.name, vp->bit);
+            errors++;
+        }
+        VPORTC.IN = ~expected;
+        if (getGpibPinState(l.pin) != LOW) {
+            printf("read %s: HIGH with PC%u LOW\n", l.name, vp->bit);
+            errors++;
+        }
+    }
+
+    if (all != 0xFF) {
+        printf("The control lines do not use each bit of PORTC once: 0x%02X\n", all);
+        errors++;
+    }
+
+    // Lines outside of the mask do not change
+    resetPort();
+    setGpibCtrlState(0xFF, 0);
+    setGpibCtrlDir(0x00, 0);
+    if (PORTC.OUTSET.writes || PORTC.OUTCLR.writes || PORTC.DIRSET.writes || PORTC.DIRCLR.writes) {
+        printf("An empty mask wrote to PORTC\n");
+        errors++;
+    }
+
+    printf(errors ? "%d errors\n" : "Control line mapping OK\n", errors);
+    return errors ? 1 : 0;
+}